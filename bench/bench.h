@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+namespace Bench {
+	typedef void (*BenchFunc)(const vector<string>& args);
+
+	struct Case {
+		const char* name;
+		BenchFunc   func;
+	};
+
+	vector<Case>& cases();
+
+	struct Register {
+		Register(const char* name, BenchFunc func) {
+			cases().push_back({ name, func });
+		}
+	};
+
+	inline double now() {
+		using namespace std::chrono;
+		return duration<double>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Best wall time of `runs` calls to f, in seconds.
+	template<class F>
+	double measure(int runs, F f) {
+		double best = 1e30;
+		for (int i = 0; i < runs; i++) {
+			double t = now();
+			f();
+			t = now() - t;
+			if (t < best) best = t;
+		}
+		return best;
+	}
+
+	inline void report(string name, double bytes, double seconds, double items = 0, const char* unit = "") {
+		cout.setf(ios::fixed);
+		cout.precision(1);
+		cout << "  " << name << ": " << bytes / 1e6 / seconds << " MB/s";
+		if (items > 0) cout << ", " << items / 1e6 / seconds << " M" << unit << "/s";
+		cout.precision(2);
+		cout << " (" << seconds * 1000 << " ms)" << endl;
+	}
+
+	// the most memory the process has held at once so far, in bytes, 0
+	// where the platform does not say
+	size_t peakRss();
+
+	inline size_t argSize(const vector<string>& args, size_t i, size_t def) {
+		return i < args.size() ? (size_t)stoull(args[i]) : def;
+	}
+}
+
+#define BENCH(name) \
+	static void bench_##name(const vector<string>& args); \
+	static Bench::Register register_##name(#name, bench_##name); \
+	static void bench_##name(const vector<string>& args)
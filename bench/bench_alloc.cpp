@@ -0,0 +1,131 @@
+#include "bench.h"
+#include "corpus.h"
+#include "../src/lexer.h"
+#include "../src/ast.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Every heap allocation made by the bench executable goes through here:
+// each form of new is replaced along with the deletes that free it, so
+// what one allocates the matching one releases.
+static atomic<size_t> allocCount(0);
+static atomic<size_t> allocBytes(0);
+static atomic<size_t> freeCount(0);
+
+static void* allocate(size_t size) noexcept {
+	allocCount++;
+	allocBytes += size;
+	return malloc(size ? size : 1);
+}
+
+static void release(void* p) noexcept {
+	if (p != nullptr) freeCount++;
+	free(p);
+}
+
+// malloc's block, rounded up to align, with the block itself kept just
+// before what is handed out
+static void* allocateAligned(size_t size, align_val_t align) noexcept {
+	auto a = (size_t)align;
+	auto block = (char*)allocate(size + a + sizeof(void*));
+	if (block == nullptr) return nullptr;
+	auto p = (char*)(((uintptr_t)block + sizeof(void*) + a - 1) & ~(uintptr_t)(a - 1));
+	((void**)p)[-1] = block;
+	return p;
+}
+
+static void releaseAligned(void* p) noexcept {
+	release(p != nullptr ? ((void**)p)[-1] : nullptr);
+}
+
+void* operator new(size_t size) {
+	if (void* p = allocate(size)) return p;
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	if (void* p = allocate(size)) return p;
+	throw bad_alloc();
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { release(p); }
+
+void* operator new(size_t size, align_val_t align) {
+	if (void* p = allocateAligned(size, align)) return p;
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size, align_val_t align) {
+	if (void* p = allocateAligned(size, align)) return p;
+	throw bad_alloc();
+}
+
+void* operator new(size_t size, align_val_t align, const nothrow_t&) noexcept { return allocateAligned(size, align); }
+void* operator new[](size_t size, align_val_t align, const nothrow_t&) noexcept { return allocateAligned(size, align); }
+
+void operator delete(void* p, align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept { releaseAligned(p); }
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept { releaseAligned(p); }
+
+namespace {
+	struct AllocSpan {
+		size_t count = allocCount;
+		size_t bytes = allocBytes;
+		size_t frees = freeCount;
+
+		void report(const char* name, size_t tokens) {
+			auto n = allocCount - count;
+			cout << "  " << name << ": " << n << " allocations, " << (allocBytes - bytes) / 1024 << " KB, " << freeCount - frees << " frees";
+			if (tokens > 0) {
+				cout.setf(ios::fixed);
+				cout.precision(2);
+				cout << ", " << (double)n / tokens << " per token";
+			}
+			cout << endl;
+			count = allocCount;
+			bytes = allocBytes;
+			frees = freeCount;
+		}
+	};
+}
+
+// alloc [megabytes]
+BENCH(alloc) {
+	auto bytes = Bench::argSize(args, 0, 4) << 20;
+
+	auto corpus = Bench::generateCorpus(bytes);
+	string path = "bench_alloc.rw";
+	if (!Bench::writeCorpus(path, corpus)) {
+		cout << "  cannot write " << path << endl;
+		return;
+	}
+
+	{
+		AllocSpan span;
+		{
+			// on the stack, so the counts are only what they take themselves
+			Lang::Lexer lexer(path);
+			size_t tokens = lexer.count();
+			span.report("lex    ", tokens);
+			Lang::AST ast(&lexer);
+			ast.parse();
+			span.report("parse  ", tokens);
+		}
+		span.report("destroy", 0);
+	}
+
+	remove(path.c_str());
+}
@@ -0,0 +1,70 @@
+#include <memory>
+#include "bench.h"
+#include "corpus.h"
+#include "../src/lexer.h"
+#include "../src/ast.h"
+#include "../src/flat_ast.h"
+#include "../src/ast_writer.h"
+
+using namespace Lang;
+
+// flat [megabytes] [runs]
+BENCH(flat) {
+	auto bytes = Bench::argSize(args, 0, 16) << 20;
+	auto runs = (int)Bench::argSize(args, 1, 5);
+
+	auto corpus = Bench::generateCorpus(bytes);
+	string path = "bench_flat.rw";
+	string saved = "bench_flat.ast";
+	if (!Bench::writeCorpus(path, corpus)) {
+		cout << "  cannot write " << path << endl;
+		return;
+	}
+
+	auto parse = Bench::measure(runs, [&]() {
+		Lexer lexer(path);
+		AST ast(&lexer);
+		ast.parse();
+	});
+	Bench::report("parse   ", (double)corpus.size(), parse);
+
+	Lexer lexer(path);
+	AST ast(&lexer);
+	auto root = ast.parse();
+
+	unique_ptr<FlatAST> flat;
+	auto flatten = Bench::measure(runs, [&]() {
+		flat.reset(new FlatAST(root));
+	});
+	Bench::report("flatten ", (double)corpus.size(), flatten, (double)flat->size(), "nodes");
+
+	auto save = Bench::measure(runs, [&]() {
+		flat->save(saved);
+	});
+	Bench::report("save    ", (double)corpus.size(), save);
+
+	FlatAST loaded;
+	auto load = Bench::measure(runs, [&]() {
+		if (!loaded.load(saved)) cout << "  cannot load " << saved << endl;
+	});
+	Bench::report("load    ", (double)corpus.size(), load, (double)loaded.size(), "nodes");
+
+	auto inflate = Bench::measure(runs, [&]() {
+		AST copy(nullptr);
+		loaded.inflate(copy);
+	});
+	Bench::report("inflate ", (double)corpus.size(), inflate, (double)loaded.size(), "nodes");
+
+	AST copy(nullptr);
+	Sink inflated, parsed;
+	writeTree(inflated, loaded.inflate(copy), TreeFormat::Html);
+	writeTree(parsed, root, TreeFormat::Html);
+	inflated.close();
+	parsed.close();
+	if (parsed.str().empty() || inflated.str() != parsed.str()) {
+		cout << "  inflated tree differs from the parsed one" << endl;
+	}
+
+	remove(path.c_str());
+	remove(saved.c_str());
+}
@@ -0,0 +1,232 @@
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "bench.h"
+#include "corpus.h"
+#include "../src/lexer.h"
+#include "../src/ast.h"
+#include "../src/ast_writer.h"
+
+using namespace Lang;
+
+namespace {
+	struct Format {
+		const char* name;
+		TreeFormat  format;
+	};
+
+	const Format Formats[] = {
+		{ "html ", TreeFormat::Html },
+		{ "json ", TreeFormat::Json },
+		{ "sexpr", TreeFormat::Sexpr },
+		{ "bin  ", TreeFormat::Binary },
+	};
+
+	// text read back in text mode, so line endings are as written
+	string readFile(const string& path, bool binary) {
+		ifstream in(path, binary ? ios::binary | ios::in : ios::in);
+		stringstream ss;
+		ss << in.rdbuf();
+		return ss.str();
+	}
+
+	// A json value read as a standard reader reads it: of two equal keys
+	// in one object the last wins. Numbers and true are kept as written.
+	struct Json {
+		string            text;
+		map<string, Json> fields;
+		vector<Json>      items;
+	};
+
+	bool readJson(const char*& p, const char* end, Json& v) {
+		auto str = [&](string& s) {
+			for (p++; p < end && *p != '"'; p++) {
+				if (*p == '\\' && ++p == end) return false;
+				s += *p;
+			}
+			return p++ < end;
+		};
+		if (p == end) return false;
+		if (*p == '"') return str(v.text);
+		if (*p == '{' || *p == '[') {
+			bool object = *p++ == '{';
+			while (p < end && *p != (object ? '}' : ']')) {
+				if (*p == ',') p++;
+				if (!object) {
+					v.items.emplace_back();
+					if (!readJson(p, end, v.items.back())) return false;
+					continue;
+				}
+				string key;
+				if (p == end || *p != '"' || !str(key) || p == end || *p++ != ':') return false;
+				Json field;
+				if (!readJson(p, end, field)) return false;
+				v.fields[key] = field;
+			}
+			return p++ < end;
+		}
+		while (p < end && *p != ',' && *p != '}' && *p != ']') v.text += *p++;
+		return true;
+	}
+
+	// the first node of a kind under v, nullptr when there is none
+	const Json* findKind(const Json& v, const string& kind) {
+		auto k = v.fields.find("kind");
+		if (k != v.fields.end() && k->second.text == kind) return &v;
+		for (auto& f : v.fields) {
+			if (auto r = findKind(f.second, kind)) return r;
+		}
+		for (auto& i : v.items) {
+			if (auto r = findKind(i, kind)) return r;
+		}
+		return nullptr;
+	}
+
+	size_t fileSize(const string& path) {
+		ifstream in(path, ios::binary | ios::ate);
+		return in ? (size_t)in.tellg() : 0;
+	}
+
+	// Reads a bin file as a tool would, down to every node and text,
+	// and returns how many nodes there are; 0 when it does not parse.
+	size_t readBinary(const string& data) {
+		auto p = (const uint8_t*)data.data();
+		auto end = p + data.size();
+		auto varint = [&]() {
+			uint64_t v = 0;
+			for (int shift = 0; p < end; shift += 7) {
+				auto b = *p++;
+				v |= (uint64_t)(b & 0x7f) << shift;
+				if (b < 0x80) break;
+			}
+			return v;
+		};
+		if (data.size() < 5 || data.compare(0, 4, "XSAB") != 0) return 0;
+		p += 5;
+
+		typedef AST::Node N;
+		size_t nodes = 0;
+		// list items still to come, per node whose children are being read
+		vector<uint64_t> open;
+		while (p < end) {
+			auto k = *p++;
+			auto kind = (N::Kind)(k & 0x3f);
+			nodes++;
+			if (k & 0x40 && (*p++ & 2)) varint();
+			if (k & 0x80) {
+				switch (kind) {
+				case N::nkLiteral: case N::nkIdentifier: case N::nkOperator:
+				case N::nkBinaryOperator: case N::nkUnaryOperator: case N::nkAssign: {
+					auto t = varint();
+					if ((t & 1) == 0) p += t >> 1;
+					break;
+				}
+				default:
+					break;
+				}
+				varint();
+			}
+			bool leaf = kind == N::nkLiteral || kind == N::nkIdentifier || kind == N::nkOperator || kind == N::nkBreak;
+			if (!leaf) open.push_back(0);
+			// after each node, the next item of a list or tags up to a child
+			for (bool ended = leaf; p <= end;) {
+				if (ended) {
+					if (open.empty()) return p == end ? nodes : 0;
+					if (open.back() > 0 && --open.back() > 0) break;
+				}
+				if (p == end) return 0;
+				auto tag = *p++;
+				ended = tag == 0;
+				if (ended) {
+					open.pop_back();
+					continue;
+				}
+				if ((tag & 0x80) == 0) break;
+				open.back() = varint();
+				if (open.back() > 0) break;
+			}
+		}
+		return 0;
+	}
+}
+
+// Writes one tree in each output format, the size of each beside the
+// html's, then reads the bin back.
+// format [megabytes] [runs]
+BENCH(format) {
+	auto bytes = Bench::argSize(args, 0, 16) << 20;
+	auto runs = (int)Bench::argSize(args, 1, 3);
+
+	auto corpus = Bench::generateCorpus(bytes);
+	string path = "bench_format.rw";
+	if (!Bench::writeCorpus(path, corpus)) {
+		cout << "  cannot write " << path << endl;
+		return;
+	}
+
+	Lexer lexer(path);
+	AST ast(&lexer);
+	auto root = ast.parse();
+
+	size_t htmlSize = 0;
+	for (auto& f : Formats) {
+		auto out = path + treeFormatExtension(f.format);
+		bool ok = true;
+		auto write = Bench::measure(runs, [&]() {
+			Sink sink;
+			ok = sink.open(out, isBinaryTreeFormat(f.format));
+			writeTree(sink, root, f.format);
+			ok = sink.close() && ok;
+		});
+		if (!ok) cout << "  cannot write " << out << endl;
+		auto size = fileSize(out);
+		if (f.format == TreeFormat::Html) htmlSize = size;
+		Bench::report(f.name, (double)corpus.size(), write);
+		cout.precision(1);
+		cout << "    " << size / 1e6 << " MB";
+		if (f.format != TreeFormat::Html && size > 0) cout << ", 1/" << (double)htmlSize / size << " of the html";
+		cout << endl;
+	}
+
+	// the same output kept in memory, as bench flat compares trees
+	for (auto& f : Formats) {
+		Sink memory;
+		writeTree(memory, root, f.format);
+		memory.close();
+		if (memory.str() != readFile(path + treeFormatExtension(f.format), isBinaryTreeFormat(f.format))) {
+			cout << "  " << f.name << " in memory differs from the file" << endl;
+		}
+	}
+
+	// an assignment's operator next to the value it assigns; a += b on
+	// its own is a BinaryOperator, after a declaration an Assign
+	{
+		Source source;
+		source.assign("fn f() { var a: int += b; }");
+		Lexer small(&source);
+		AST tree(&small);
+		Sink json;
+		writeTree(json, tree.parse(), TreeFormat::Json);
+		json.close();
+		Json v;
+		auto p = json.str().data();
+		const Json* assign = nullptr;
+		if (readJson(p, p + json.str().size(), v)) assign = findKind(v, "Assign");
+		if (assign == nullptr || !assign->fields.count("text") || assign->fields.at("text").text != "+=" ||
+			!assign->fields.count("value") || !assign->fields.at("value").fields.count("kind")) {
+			cout << "  json of a += b has lost the operator: " << json.str();
+		}
+	}
+
+	auto bin = path + treeFormatExtension(TreeFormat::Binary);
+	auto data = readFile(bin, true);
+	size_t nodes = 0;
+	auto read = Bench::measure(runs, [&]() {
+		nodes = readBinary(data);
+	});
+	if (nodes == 0) cout << "  cannot read " << bin << endl;
+	Bench::report("read bin", (double)data.size(), read, (double)nodes, "nodes");
+
+	for (auto& f : Formats) remove((path + treeFormatExtension(f.format)).c_str());
+	remove(path.c_str());
+}
@@ -0,0 +1,94 @@
+#include "bench.h"
+#include "corpus.h"
+#include "../src/document.h"
+#include "../src/ast_visit.h"
+
+using namespace Lang;
+
+namespace {
+	// the offsets of every token under the nodes, in tree order
+	template <class List>
+	vector<unsigned> offsets(const List& nodes) {
+		vector<unsigned> list;
+		vector<AST::Node*> stack(nodes.begin(), nodes.end());
+		reverse(stack.begin(), stack.end());
+		while (!stack.empty()) {
+			auto n = stack.back();
+			stack.pop_back();
+			if (n == nullptr) continue;
+			if (n->token != nullptr) list.push_back(n->token->offset);
+			auto top = stack.size();
+			forEachChild(n, [&](AST::Node* c) { stack.push_back(c); });
+			reverse(stack.begin() + top, stack.end());
+		}
+		return list;
+	}
+}
+
+// incremental [lines] [edits]
+BENCH(incremental) {
+	auto lines = Bench::argSize(args, 0, 50000);
+	auto edits = (int)Bench::argSize(args, 1, 1000);
+
+	// grow the corpus until it has the lines asked for
+	string corpus;
+	for (size_t bytes = lines * 24;; bytes += bytes / 4) {
+		corpus = Bench::generateCorpus(bytes);
+		if ((size_t)count(corpus.begin(), corpus.end(), '\n') >= lines) break;
+	}
+	auto lineCount = count(corpus.begin(), corpus.end(), '\n');
+
+	auto full = Bench::measure(3, [&]() {
+		Source source;
+		source.assign(corpus);
+		Lexer lexer(&source);
+		AST ast(&lexer);
+		ast.parse();
+	});
+	Bench::report("full    ", (double)corpus.size(), full);
+
+	Document doc(corpus);
+	cout << "  " << lineCount << " lines, " << doc.chunkCount() << " chunks" << endl;
+
+	// type a space somewhere and take it back, as an editor would send
+	Bench::Rng rng(7);
+	size_t reparsed = 0;
+	double t = Bench::now();
+	for (int i = 0; i < edits; i++) {
+		auto offset = (size_t)(rng.next() % corpus.size());
+		doc.edit(offset, 0, " ");
+		reparsed += doc.reparsed();
+		doc.edit(offset, 1, "");
+		reparsed += doc.reparsed();
+	}
+	t = (Bench::now() - t) / (edits * 2);
+
+	cout.setf(ios::fixed);
+	cout.precision(3);
+	cout << "  edit    : " << t * 1000 << " ms per edit, " << (double)reparsed / (edits * 2)
+		<< " chunks reparsed, " << full / t << "x faster than full" << endl;
+
+	if (doc.text() != corpus || !doc.diagnostics().empty()) {
+		cout << "  document differs from the corpus" << endl;
+	}
+
+	// the tokens where a full parse puts them, before and after an edit
+	// that moves every chunk past it
+	for (int i = 0; i < 2; i++) {
+		if (i > 0) {
+			doc.edit(corpus.size() / 3, 0, "\n\n");
+			corpus.insert(corpus.size() / 3, "\n\n");
+		}
+		Source source;
+		source.assign(corpus);
+		Lexer lexer(&source);
+		AST ast(&lexer);
+		if (offsets(doc.nodes()) != offsets(cast<AST::BlockNode>(ast.parse())->nodes)) {
+			cout << "  token offsets differ from a full parse" << endl;
+		}
+		int row, col, fullRow, fullCol;
+		doc.position(corpus.size() * 2 / 3, &row, &col);
+		source.position(corpus.size() * 2 / 3, &fullRow, &fullCol);
+		if (row != fullRow || col != fullCol) cout << "  positions differ from a full parse" << endl;
+	}
+}
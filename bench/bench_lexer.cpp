@@ -0,0 +1,43 @@
+#include "bench.h"
+#include "corpus.h"
+#include "../src/lexer.h"
+
+// lexer [megabytes] [runs]
+BENCH(lexer) {
+	auto bytes = Bench::argSize(args, 0, 32) << 20;
+	auto runs = (int)Bench::argSize(args, 1, 5);
+
+	auto corpus = Bench::generateCorpus(bytes);
+	string path = "bench_lexer.rw";
+	if (!Bench::writeCorpus(path, corpus)) {
+		cout << "  cannot write " << path << endl;
+		return;
+	}
+
+	int count = 0;
+	auto lex = [&]() {
+		Lang::Lexer lexer(path);
+		count = lexer.count();
+	};
+
+	Lang::Lexer::useSimd = false;
+	auto scalar = Bench::measure(runs, lex);
+	Bench::report("scalar", (double)corpus.size(), scalar, count, "tokens");
+
+	Lang::Lexer::useSimd = true;
+	auto simd = Bench::measure(runs, lex);
+	Bench::report("simd  ", (double)corpus.size(), simd, count, "tokens");
+
+	// pulling tokens one at a time through the streaming window
+	auto stream = Bench::measure(runs, [&]() {
+		Lang::Source source;
+		source.open(path);
+		Lang::Lexer lexer(&source, true);
+		int i = 0;
+		while (lexer.at(i) != Lang::Token::Empty) lexer.release(++i);
+		count = i;
+	});
+	Bench::report("stream", (double)corpus.size(), stream, count, "tokens");
+
+	remove(path.c_str());
+}
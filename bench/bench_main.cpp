@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Bench {
+	vector<Case>& cases() {
+		static vector<Case> list;
+		return list;
+	}
+
+	size_t peakRss() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+		return pmc.PeakWorkingSetSize;
+#else
+		struct rusage ru;
+		if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+		// kilobytes on Linux
+		return (size_t)ru.ru_maxrss * 1024;
+#endif
+	}
+}
+
+// bench [name [args...]]
+// Runs every registered benchmark, or only `name` with its own arguments.
+int main(int argc, char** argv) {
+	auto args = vector<string>(argv + 1, argv + argc);
+	string only = args.empty() ? "" : args[0];
+	if (!args.empty()) args.erase(args.begin());
+
+	bool found = false;
+	for (auto& c : Bench::cases()) {
+		if (!only.empty() && only != c.name) continue;
+		found = true;
+		cout << c.name << endl;
+		c.func(args);
+		cout << "  peak RSS so far: " << Bench::peakRss() / (1 << 20) << " MB" << endl;
+	}
+	if (!found) {
+		cout << "unknown benchmark " << only << ", available:";
+		for (auto& c : Bench::cases()) cout << " " << c.name;
+		cout << endl;
+		return 1;
+	}
+	return 0;
+}
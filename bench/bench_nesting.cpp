@@ -0,0 +1,76 @@
+#include "bench.h"
+#include "../src/lexer.h"
+#include "../src/ast.h"
+#include "../src/resolver.h"
+
+using namespace Lang;
+
+namespace {
+	string repeat(const string& s, size_t n) {
+		string r;
+		r.reserve(s.size() * n);
+		for (size_t i = 0; i < n; i++) r += s;
+		return r;
+	}
+
+	struct Shape {
+		const char* name;
+		// parsed by recursion, so not without the limit
+		bool        recursive;
+		string (*make)(size_t depth);
+	};
+
+	const Shape Shapes[] = {
+		{ "parens  ", false, [](size_t d) { return "var a = " + repeat("(", d) + "1" + repeat(")", d) + ";\n"; } },
+		{ "calls   ", false, [](size_t d) { return "var a = " + repeat("f(", d) + "1" + repeat(")", d) + ";\n"; } },
+		{ "tuples  ", false, [](size_t d) { return "var a = " + repeat("(", d) + "1" + repeat(", 1)", d) + ";\n"; } },
+		{ "index   ", false, [](size_t d) { return "var a = " + repeat("a[", d) + "1" + repeat("]", d) + ";\n"; } },
+		{ "unary   ", false, [](size_t d) { return "var a = " + repeat("-", d) + "1;\n"; } },
+		{ "chain   ", false, [](size_t d) { return "var a = a" + repeat(" + a", d) + ";\n"; } },
+		{ "else if ", false, [](size_t d) { return "if a {}" + repeat(" else if a {}", d) + " else {}\n"; } },
+		{ "blocks  ", true,  [](size_t d) { return repeat("{", d) + repeat("}", d) + "\n"; } },
+		{ "generics", true,  [](size_t d) { return "var a: " + repeat("t<", d) + "t" + repeat(">", d) + ";\n"; } },
+	};
+}
+
+// Each shape nested depth levels deep, parsed under the default limit
+// and, when that stops it, without one where the parser takes no stack
+// for the shape. Blocks and generic types recurse, so they are only
+// parsed under the limit. A tree that parsed is then resolved, which
+// takes no stack for any shape.
+// nesting [depth] [runs]
+BENCH(nesting) {
+	auto depth = Bench::argSize(args, 0, 100000);
+	auto runs = (int)Bench::argSize(args, 1, 3);
+
+	for (auto& shape : Shapes) {
+		auto text = shape.make(depth);
+		Source source;
+		source.assign(text);
+		Lexer lexer(&source);
+
+		for (int limit : { AST::DefaultMaxDepth, 0 }) {
+			if (limit == 0 && shape.recursive) break;
+			bool failed = false;
+			auto parse = Bench::measure(runs, [&]() {
+				auto reported = lexer.diagnostics().size();
+				AST ast(&lexer);
+				ast.maxDepth = limit;
+				ast.parse();
+				failed = lexer.diagnostics().size() > reported;
+			});
+			Bench::report(string(shape.name) + (limit == 0 ? " (no limit)" : ""), (double)text.size(), parse, lexer.count(), "tokens");
+			if (!failed) {
+				AST ast(&lexer);
+				ast.maxDepth = limit;
+				auto root = ast.parse();
+				auto resolve = Bench::measure(runs, [&]() {
+					Resolver::resolve(root);
+				});
+				Bench::report("  resolve", (double)text.size(), resolve, lexer.count(), "tokens");
+				break;
+			}
+			cout << "  stopped at " << limit << " levels" << endl;
+		}
+	}
+}
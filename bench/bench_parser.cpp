@@ -0,0 +1,122 @@
+#include "bench.h"
+#include "corpus.h"
+#include "../src/lexer.h"
+#include "../src/ast.h"
+#include "../src/ast_visit.h"
+#include "../src/pool.h"
+#include "../src/resolver.h"
+
+using namespace Lang;
+
+namespace {
+	// counts identifiers and operators, the sort of question a pass asks
+	class Counter : public NodeVisitor<Counter> {
+	public:
+		size_t nodes       = 0;
+		size_t identifiers = 0;
+		size_t operators   = 0;
+
+		void visitNode(AST::Node* n) {
+			nodes++;
+			visitChildren(n);
+		}
+
+		void visitIdentifier(AST::IdentifierNode* n) {
+			identifiers++;
+			visitNode(n);
+		}
+
+		void visitOperator(AST::OperatorNode* n) {
+			operators++;
+			visitNode(n);
+		}
+	};
+
+	// the same count asking RTTI at every node, as the parser used to
+	void countByRtti(AST::Node* root, Counter& c) {
+		vector<AST::Node*> stack{ root };
+		while (!stack.empty()) {
+			auto n = stack.back();
+			stack.pop_back();
+			c.nodes++;
+			if (dynamic_cast<AST::IdentifierNode*>(n) != nullptr) c.identifiers++;
+			else if (dynamic_cast<AST::OperatorNode*>(n) != nullptr) c.operators++;
+			forEachChild(n, [&](AST::Node* child) { stack.push_back(child); });
+		}
+	}
+}
+
+// parser [megabytes] [runs] [threads]
+BENCH(parser) {
+	auto bytes = Bench::argSize(args, 0, 16) << 20;
+	auto runs = (int)Bench::argSize(args, 1, 5);
+	auto threads = (unsigned)Bench::argSize(args, 2, 0);
+
+	auto corpus = Bench::generateCorpus(bytes);
+	string path = "bench_parser.rw";
+	if (!Bench::writeCorpus(path, corpus)) {
+		cout << "  cannot write " << path << endl;
+		return;
+	}
+
+	Lexer lexer(path);
+	AST::Node* root = nullptr;
+	AST* ast = nullptr;
+	auto parse = Bench::measure(runs, [&]() {
+		delete ast;
+		ast = new AST(&lexer);
+		root = ast->parse();
+	});
+	Bench::report("parse   ", (double)corpus.size(), parse, lexer.count(), "tokens");
+
+	// declarations split over the threads, 0 for one per hardware thread
+	WorkPool pool(threads);
+	AST* split = nullptr;
+	auto parallel = Bench::measure(runs, [&]() {
+		delete split;
+		split = new AST(&lexer);
+		split->parse(pool);
+	});
+	Bench::report("parallel", (double)corpus.size(), parallel, lexer.count(), "tokens");
+	delete split;
+
+	Counter counter;
+	auto visitor = Bench::measure(runs, [&]() {
+		counter = Counter();
+		counter.visitTree(root);
+	});
+	Bench::report("visitor ", (double)corpus.size(), visitor, (double)counter.nodes, "nodes");
+
+	Counter rtti;
+	auto casts = Bench::measure(runs, [&]() {
+		rtti = Counter();
+		countByRtti(root, rtti);
+	});
+	Bench::report("rtti    ", (double)corpus.size(), casts, (double)rtti.nodes, "nodes");
+
+	if (rtti.identifiers != counter.identifiers || rtti.operators != counter.operators) {
+		cout << "  counts differ" << endl;
+	}
+
+	size_t unresolved = 0;
+	auto resolve = Bench::measure(runs, [&]() {
+		unresolved = Resolver::resolve(root);
+	});
+	Bench::report("resolve ", (double)corpus.size(), resolve, (double)counter.identifiers, "identifiers");
+	cout << "  " << unresolved << " unresolved" << endl;
+
+	// a return type that fails drops its function, body and all, and the
+	// declaration after it is parsed as if nothing happened
+	Source broken;
+	broken.assign("fn f() -> ( { a; }\nfn g() {}\n");
+	Lexer brokenLexer(&broken);
+	AST brokenAst(&brokenLexer);
+	auto& decls = cast<AST::BlockNode>(brokenAst.parse())->nodes;
+	auto g = decls.size() == 1 ? dyn_cast<AST::DefineFuncNode>(decls[0]) : nullptr;
+	if (brokenLexer.diagnostics().size() != 1 || g == nullptr || g->name->name->token->value != "g") {
+		cout << "  a bad return type is not recovered from: " << brokenLexer.diagnostics().str() << endl;
+	}
+
+	delete ast;
+	remove(path.c_str());
+}
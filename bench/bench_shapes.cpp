@@ -0,0 +1,82 @@
+#include "bench.h"
+#include "corpus.h"
+#include "../src/lexer.h"
+#include "../src/ast.h"
+#include "../src/ast_visit.h"
+#include "../src/ast_writer.h"
+
+using namespace Lang;
+
+namespace {
+	// with a stack of its own, as the nesting shape is deep
+	size_t countNodes(AST::Node* root) {
+		size_t n = 0;
+		vector<AST::Node*> stack;
+		if (root != nullptr) stack.push_back(root);
+		while (!stack.empty()) {
+			auto node = stack.back();
+			stack.pop_back();
+			n++;
+			forEachChild(node, [&](AST::Node* c) { stack.push_back(c); });
+		}
+		return n;
+	}
+}
+
+// The whole pipeline over each corpus shape in turn: lexing, parsing and
+// writing the html, which is reported by the bytes written. The shape
+// name picks one (mixed, chains, nesting, declarations, text, unicode).
+// shapes [megabytes] [runs] [shape]
+BENCH(shapes) {
+	auto bytes = Bench::argSize(args, 0, 16) << 20;
+	auto runs = (int)Bench::argSize(args, 1, 3);
+	string only = args.size() > 2 ? args[2] : "";
+
+	for (auto& s : Bench::shapes()) {
+		if (!only.empty() && only != s.name) continue;
+		cout << " " << s.name << endl;
+		auto corpus = Bench::generateCorpus(bytes, s.shape);
+		string path = string("bench_shapes_") + s.name + ".rw";
+		if (!Bench::writeCorpus(path, corpus)) {
+			cout << "  cannot write " << path << endl;
+			continue;
+		}
+
+		Source source;
+		source.open(path);
+		int tokens = 0;
+		auto lex = Bench::measure(runs, [&]() {
+			Lexer lexer(&source);
+			tokens = lexer.count();
+		});
+		Bench::report("lex     ", (double)corpus.size(), lex, tokens, "tokens");
+
+		Lexer lexer(&source);
+		AST* ast = nullptr;
+		AST::Node* root = nullptr;
+		auto parse = Bench::measure(runs, [&]() {
+			delete ast;
+			ast = new AST(&lexer);
+			root = ast->parse();
+		});
+		if (!ast->diagnostics().empty()) cout << "  " << ast->diagnostics().str() << endl;
+		auto nodes = countNodes(root);
+		Bench::report("parse   ", (double)corpus.size(), parse, (double)nodes, "nodes");
+
+		string out = path + ".html";
+		size_t written = 0;
+		auto print = Bench::measure(runs, [&]() {
+			Sink sink;
+			if (!sink.open(out)) return;
+			writeTree(sink, root, TreeFormat::Html);
+			written = sink.size();
+			sink.close();
+		});
+		Bench::report("print   ", (double)written, print, (double)nodes, "nodes");
+		cout << "  peak RSS so far: " << Bench::peakRss() / (1 << 20) << " MB" << endl;
+
+		delete ast;
+		remove(out.c_str());
+		remove(path.c_str());
+	}
+}
@@ -0,0 +1,16 @@
+#include "bench.h"
+#include "corpus.h"
+#include "../src/utf8.h"
+
+// utf8 [megabytes] [runs]
+BENCH(utf8) {
+	auto bytes = Bench::argSize(args, 0, 32) << 20;
+	auto runs = (int)Bench::argSize(args, 1, 5);
+
+	auto corpus = Bench::generateCorpus(bytes);
+	bool valid = false;
+	auto t = Bench::measure(runs, [&]() {
+		valid = isUTF8(corpus.data(), corpus.size());
+	});
+	Bench::report(valid ? "valid" : "INVALID", (double)corpus.size(), t);
+}
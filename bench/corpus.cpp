@@ -0,0 +1,179 @@
+#include "corpus.h"
+#include <fstream>
+#include <sstream>
+
+namespace Bench {
+	static const char* Names[] = { "a", "b", "count", "index", "value", "point", "list", "今天", "名字", "größe" };
+	static const char* UnicodeNames[] = { "今天", "名字", "größe", "значение", "μέτρο", "café", "naïve", "日付" };
+	static const char* Words[] = { "the", "quick", "转义", "value", "of", "größe", "is", "computed", "from", "名字" };
+	static const char* Types[] = { "int", "float", "string", "bool", "byte" };
+
+	// Each part below draws from r only for what its shape asks for beyond
+	// the defaults, so the default shape gives the program it always did.
+
+	static string name(Rng& r, const Shape& shape) {
+		stringstream ss;
+		if (shape.unicode) ss << UnicodeNames[r.range(0, 7)] << r.range(0, 99);
+		else ss << Names[r.range(0, 9)] << r.range(0, 99);
+		return ss.str();
+	}
+
+	// words to make strings and comments shape.text bytes longer
+	static string filler(Rng& r, const Shape& shape) {
+		string s;
+		while ((int)s.size() < shape.text) {
+			s += " ";
+			s += Words[r.range(0, 9)];
+		}
+		return s;
+	}
+
+	static string operand(Rng& r, const Shape& shape) {
+		switch (r.range(0, 4)) {
+		case 0: return to_string(r.range(0, 100000));
+		case 1: return to_string(r.range(0, 999)) + "." + to_string(r.range(0, 999));
+		case 2: return name(r, shape) + "." + name(r, shape);
+		case 3: return name(r, shape) + "(" + name(r, shape) + ", " + to_string(r.range(0, 9)) + ")";
+		}
+		return name(r, shape);
+	}
+
+	static string expression(Rng& r, const Shape& shape) {
+		static const char* ops[] = { " + ", " - ", " * ", " / ", " % ", " == ", " < ", " >= ", " && ", " || " };
+		string s = operand(r, shape);
+		int n = r.range(0, shape.chain);
+		for (int i = 0; i < n; i++) {
+			s += ops[r.range(0, 9)];
+			s += r.range(0, 4) == 0 ? "(" + operand(r, shape) + " - " + operand(r, shape) + ")" : operand(r, shape);
+		}
+		return s;
+	}
+
+	static void statement(Rng& r, stringstream& ss, string indent, const Shape& shape, int depth) {
+		// down to shape.nesting levels, each holding the next and one more
+		if (depth < shape.nesting) {
+			if (r.range(0, 1) == 0) ss << indent << "if " << expression(r, shape) << " {\n";
+			else ss << indent << "loop {\n";
+			statement(r, ss, indent + "\t", shape, depth + 1);
+			statement(r, ss, indent + "\t", shape, shape.nesting);
+			ss << indent << "}\n";
+			return;
+		}
+		auto text = [&]() { return shape.text > 0 ? filler(r, shape) : string(); };
+		switch (r.range(0, 5)) {
+		case 0:
+			ss << indent << "var " << name(r, shape) << " = " << expression(r, shape) << "\n";
+			break;
+		case 1:
+			ss << indent << "var " << name(r, shape) << ": " << Types[r.range(0, 4)] << "[" << r.range(1, 16) << "]\n";
+			break;
+		case 2:
+			ss << indent << "if " << expression(r, shape) << " {\n";
+			ss << indent << "\t" << name(r, shape) << " = " << expression(r, shape) << "\n";
+			ss << indent << "} else {\n";
+			ss << indent << "\t" << name(r, shape) << " = \"some text\\n with 转义" << text() << "\"\n";
+			ss << indent << "}\n";
+			break;
+		case 3:
+			ss << indent << "loop each var " << name(r, shape) << " in " << name(r, shape) << " {\n";
+			ss << indent << "\tprintln(" << expression(r, shape) << ")\n";
+			ss << indent << "}\n";
+			break;
+		case 4:
+			ss << indent << "// " << name(r, shape) << " is computed from " << name(r, shape) << text() << "\n";
+			ss << indent << name(r, shape) << " = " << expression(r, shape) << "\n";
+			break;
+		default:
+			ss << indent << "/* block comment " << name(r, shape) << text() << " */ println(\"" << name(r, shape) << "\", " << expression(r, shape) << ")\n";
+			break;
+		}
+	}
+
+	static void function(Rng& r, stringstream& ss, string indent, const Shape& shape) {
+		ss << indent << "fn " << name(r, shape) << "(";
+		int args = r.range(0, 3);
+		for (int i = 0; i < args; i++) {
+			if (i > 0) ss << ", ";
+			ss << name(r, shape) << ": " << Types[r.range(0, 4)];
+		}
+		ss << ") -> " << Types[r.range(0, 4)] << " {\n";
+		int n = r.range(shape.minBody, shape.maxBody);
+		for (int i = 0; i < n; i++) statement(r, ss, indent + "\t", shape, 0);
+		ss << indent << "\treturn " << expression(r, shape) << "\n";
+		ss << indent << "}\n\n";
+	}
+
+	static void interface(Rng& r, stringstream& ss, const Shape& shape) {
+		ss << "interface " << name(r, shape) << " {\n";
+		int n = r.range(1, 4);
+		for (int i = 0; i < n; i++) {
+			ss << "\tfn " << name(r, shape) << "(" << name(r, shape) << ": " << Types[r.range(0, 4)] << ") -> " << Types[r.range(0, 4)] << ",\n";
+		}
+		ss << "}\n\n";
+	}
+
+	const vector<NamedShape>& shapes() {
+		static const vector<NamedShape> list = [] {
+			vector<NamedShape> l;
+			Shape s;
+			l.push_back({ "mixed", s });
+			s = Shape();
+			s.chain = 64;
+			l.push_back({ "chains", s });
+			s = Shape();
+			s.nesting = 48;
+			l.push_back({ "nesting", s });
+			s = Shape();
+			s.minBody = 0;
+			s.maxBody = 1;
+			s.interfaces = true;
+			l.push_back({ "declarations", s });
+			s = Shape();
+			s.text = 400;
+			l.push_back({ "text", s });
+			s = Shape();
+			s.unicode = true;
+			l.push_back({ "unicode", s });
+			return l;
+		}();
+		return list;
+	}
+
+	string generateCorpus(size_t bytes, unsigned seed) {
+		return generateCorpus(bytes, Shape(), seed);
+	}
+
+	string generateCorpus(size_t bytes, const Shape& shape, unsigned seed) {
+		Rng r(seed);
+		stringstream ss;
+		while ((size_t)ss.tellp() < bytes) {
+			switch (r.range(0, shape.interfaces ? 4 : 3)) {
+			case 0: {
+				auto s = name(r, shape);
+				ss << "struct " << s << " {\n";
+				int n = r.range(1, 6);
+				for (int i = 0; i < n; i++) ss << "\t" << name(r, shape) << ": " << Types[r.range(0, 4)] << ",\n";
+				ss << "}\n\nimpl " << s << " {\n";
+				function(r, ss, "\t", shape);
+				ss << "}\n\n";
+				break;
+			}
+			case 4:
+				interface(r, ss, shape);
+				break;
+			default:
+				function(r, ss, "", shape);
+				break;
+			}
+		}
+		return ss.str();
+	}
+
+	bool writeCorpus(string path, const string& s) {
+		fstream fs(path, ios::out | ios::binary);
+		if (!fs.is_open()) return false;
+		fs.write(s.data(), s.size());
+		fs.close();
+		return true;
+	}
+}
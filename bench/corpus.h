@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Bench {
+	// Deterministic pseudo-random source for corpus generation, so the same
+	// seed gives the same program on every platform.
+	class Rng {
+	public:
+		Rng(unsigned seed) {
+			state = seed ? seed : 1;
+		}
+
+		unsigned next() {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		int range(int lo, int hi) {
+			return lo + (int)(next() % (unsigned)(hi - lo + 1));
+		}
+
+	private:
+		unsigned state;
+	};
+
+	// What the generated program is made of. The defaults are the mix
+	// every benchmark has always used and give the same program they did;
+	// the presets in shapes() push one part of it further.
+	struct Shape {
+		// operands after the first in an expression, at most
+		int  chain      = 6;
+		// if and loop blocks nested in a function body, at most
+		int  nesting    = 0;
+		// statements in a function body
+		int  minBody    = 2;
+		int  maxBody    = 8;
+		// interfaces among the top-level declarations
+		bool interfaces = false;
+		// bytes of filler in string literals and comments
+		int  text       = 0;
+		// all names non-ASCII
+		bool unicode    = false;
+	};
+
+	struct NamedShape {
+		const char* name;
+		Shape       shape;
+	};
+
+	// mixed (the defaults), chains, nesting, declarations, text, unicode
+	const vector<NamedShape>& shapes();
+
+	// A valid XS program of roughly `bytes` bytes.
+	string generateCorpus(size_t bytes, unsigned seed = 1);
+	string generateCorpus(size_t bytes, const Shape& shape, unsigned seed = 1);
+
+	// Writes s to path, returns false on failure.
+	bool writeCorpus(string path, const string& s);
+}
@@ -0,0 +1,26 @@
+#include "arena.h"
+#include <cstdlib>
+
+namespace Lang {
+	Arena::~Arena() {
+		for (auto f = finalizers; f != nullptr; f = f->next) f->destroy(f->obj);
+		while (head != nullptr) {
+			auto prev = head->prev;
+			free(head);
+			head = prev;
+		}
+	}
+
+	char* Arena::grow(size_t size, size_t align) {
+		// oversized requests get a block of their own
+		size_t payload = size + align > blockSize ? size + align : blockSize;
+		auto b = (Block*)malloc(sizeof(Block) + payload);
+		if (b == nullptr) throw bad_alloc();
+		b->prev = head;
+		head = b;
+		count++;
+		cur = (char*)(b + 1);
+		end = cur + payload;
+		return (char*)(((size_t)cur + align - 1) & ~(align - 1));
+	}
+}
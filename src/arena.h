@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+namespace Lang {
+	// Bump allocator for objects that all die together. Allocation is a
+	// pointer bump inside the current block; destruction frees the blocks
+	// in one go after running the destructors of objects that need one.
+	class Arena {
+	public:
+		explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+		~Arena();
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(size_t size, size_t align) {
+			auto p = (char*)(((size_t)cur + align - 1) & ~(align - 1));
+			if (p + size > end) p = grow(size, align);
+			cur = p + size;
+			used += size;
+			return p;
+		}
+
+		template<class T, class... TS>
+		T* make(TS&&... args) {
+			auto obj = new (allocate(sizeof(T), alignof(T))) T(forward<TS>(args)...);
+			if (!is_trivially_destructible<T>::value) {
+				auto f = new (allocate(sizeof(Finalizer), alignof(Finalizer))) Finalizer();
+				f->destroy = [](void* p) { static_cast<T*>(p)->~T(); };
+				f->obj = obj;
+				f->next = finalizers;
+				finalizers = f;
+			}
+			return obj;
+		}
+
+		// bytes handed out and blocks taken from the heap so far
+		size_t bytes()  const { return used; }
+		size_t blocks() const { return count; }
+
+	private:
+		struct Block {
+			Block* prev;
+		};
+
+		struct Finalizer {
+			void     (*destroy)(void*);
+			void*      obj;
+			Finalizer* next;
+		};
+
+		size_t     blockSize;
+		Block*     head       = nullptr;
+		char*      cur        = nullptr;
+		char*      end        = nullptr;
+		Finalizer* finalizers = nullptr;
+		size_t     used       = 0;
+		size_t     count      = 0;
+
+		char* grow(size_t size, size_t align);
+	};
+
+	// A list kept in an arena, as the children of a node are, read like a
+	// vector. Growing doubles it into a new piece of the arena and leaves
+	// the old piece to go with the rest, so the list, and what holds it,
+	// needs no destructor.
+	template<class T>
+	class ArenaList {
+		static_assert(is_trivially_copyable<T>::value, "items are moved by memcpy");
+
+	public:
+		T*     begin() const { return items; }
+		T*     end()   const { return items + count; }
+		size_t size()  const { return count; }
+		bool   empty() const { return count == 0; }
+		T&     back()  const { return items[count - 1]; }
+		T&     operator[](size_t i) const { return items[i]; }
+
+		void push_back(Arena& arena, T item) {
+			if (count == capacity) reserve(arena, capacity == 0 ? 4 : capacity * 2);
+			items[count++] = item;
+		}
+
+		void append(Arena& arena, const T* from, size_t n) {
+			if (count + n > capacity) reserve(arena, count + n);
+			if (n > 0) memcpy(items + count, from, n * sizeof(T));
+			count += (uint32_t)n;
+		}
+
+	private:
+		T*       items    = nullptr;
+		uint32_t count    = 0;
+		uint32_t capacity = 0;
+
+		void reserve(Arena& arena, size_t n) {
+			auto p = (T*)arena.allocate(n * sizeof(T), alignof(T));
+			if (count > 0) memcpy(p, items, count * sizeof(T));
+			items = p;
+			capacity = (uint32_t)n;
+		}
+	};
+}
@@ -1,28 +1,220 @@
 #include "ast.h"
+#include "pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 
 #define NODE_P(T)    ((T*)ast->createNode<T>()->setTypeName(#T)->parse())
 #define NODE_C(T)    ((T*)ast->createNode<T>()->setTypeName(#T))
 #define NODE_AP(T,A) ((T*)ast->createNode<T>(A)->setTypeName(#T)->parse())
+// after an error a node gives up at once; BlockNode resynchronizes
+#define RETURN_IF_FAILED if (ast->panic) return nullptr
 
 namespace Lang {
-	void throwException(Token* t, string e) {
-		cout << "[" << t->row << "," << t->col << "] ";
-		throw exception(e.c_str());
+	// operator tokens the parser inserts, shared like Token::Empty
+	Token AST::FuncCallNode::Synthetic(Token::Kind::kOperator, Token::Type::tFnCall, "_FNCALL_");
+	Token AST::SubscriptNode::Synthetic(Token::Kind::kOperator, Token::Type::tSubscript, "_SUBSCRIPT_");
+	Token AST::BreakNode::Synthetic(Token::Kind::kKeyword, Token::Type::tBreak, "break");
+
+	// Reports e at t and puts the parse in panic mode: every node on the way
+	// back up returns nullptr, and the innermost block skips to a point it
+	// can go on from. Errors while panicking would only echo the first one.
+	AST::Node* AST::Node::error(Token* t, string e) {
+		if (ast->panic) return nullptr;
+		int row = 0, col = 0;
+		if (t->inStream) ast->lex->getPosition(t->offset, &row, &col);
+		ast->sink->report(row, col, move(e));
+		ast->panic = true;
+		return nullptr;
+	}
+
+	bool AST::Node::nest(Token* t) {
+		if (ast->maxDepth > 0 && ast->depth >= ast->maxDepth) {
+			error(t, "nested deeper than " + to_string(ast->maxDepth) + " levels");
+			return false;
+		}
+		ast->depth++;
+		return true;
 	}
 
 	Token* AST::tk(int offset) {
-		int i = index + offset;
-		if (i >= 0 && i < (int)lex->tokens.size()) return lex->tokens[i];
-		return Token::Empty;
+		if (lex->isStreaming()) lex->release(index);
+		if (index + offset >= end) return Token::Empty;
+		return lex->at(index + offset);
+	}
+
+	Token* AST::take() {
+		auto t = tk();
+		if (!lex->isStreaming() || t == Token::Empty) return t;
+		auto copy = arena.make<Token>(*t);
+		if (lex->ownsValue(t)) {
+			auto text = (char*)arena.allocate(t->value.size(), 1);
+			memcpy(text, t->value.data(), t->value.size());
+			copy->value = string_view(text, t->value.size());
+		}
+		return copy;
+	}
+
+	// Skips the rest of the statement that began at token start: past the
+	// next `;`, or up to a `}` closing the block or a `fn`, `struct`, `impl`
+	// or `interface`, whichever comes first. Braces in between are skipped
+	// in pairs, counting the struct, impl and interface bodies the statement
+	// left open, and the statement ends with the `}` that closes the last.
+	void AST::recover(int start, int depthCount, int bodyCount) {
+		depth = depthCount;
+		panic = false;
+		int braces = bodies - bodyCount;
+		bodies = bodyCount;
+		for (auto t = tk(); t != Token::Empty; t = tk()) {
+			if (braces == 0 && index > start && (t->isKeyword(Token::tDefineFunction) || t->isKeyword(Token::tDefineStruct) ||
+				t->isKeyword(Token::tDefineImpl) || t->isKeyword(Token::tDefineInterface))) return;
+			if (t->isOperator(Token::tLBrace)) {
+				braces++;
+			} else if (t->isOperator(Token::tRBrace)) {
+				if (braces == 0) return;
+				index += 1;
+				if (--braces == 0) return;
+				continue;
+			} else if (braces == 0 && t->isOperator(Token::tSemicolon)) {
+				index += 1;
+				return;
+			}
+			index += 1;
+		}
 	}
 
 	AST::Node* AST::parse() {
 		auto ast = this;
 		auto root = NODE_P(BlockNode);
+		if (lex->isStreaming()) lex->finish();
 		//checkNode(root);
 		return root;
 	}
 
+	AST::Node* AST::parse(WorkPool& pool) {
+		if (lex->isStreaming() || pool.size() < 2) return parse();
+		auto cuts = split(lex);
+
+		// a few runs per worker, of about equal token counts, so a long
+		// declaration does not leave the other workers idle
+		auto count = (size_t)lex->count();
+		auto runs = min(cuts.starts.size() + 1, (size_t)pool.size() * 4);
+		vector<int> bounds{ 0 };
+		for (auto s : cuts.starts) {
+			if ((size_t)s >= bounds.size() * count / runs) bounds.push_back(s);
+		}
+		if (bounds.size() < 2) return parse();
+		bounds.push_back(INT_MAX);
+
+		auto n = bounds.size() - 1;
+		vector<unique_ptr<AST>> list;
+		vector<Node*> roots(n, nullptr);
+		for (size_t i = 0; i < n; i++) {
+			list.emplace_back(new AST(lex));
+			list[i]->index = bounds[i];
+			list[i]->end = bounds[i + 1];
+			list[i]->maxDepth = maxDepth;
+			list[i]->sink = &list[i]->own;
+		}
+
+		mutex lock;
+		condition_variable done;
+		size_t left = n;
+		for (size_t i = 0; i < n; i++) {
+			pool.submit([&, i] {
+				auto ast = list[i].get();
+				roots[i] = NODE_P(BlockNode);
+				lock_guard<mutex> g(lock);
+				if (--left == 0) done.notify_all();
+			});
+		}
+		{
+			unique_lock<mutex> g(lock);
+			done.wait(g, [&] { return left == 0; });
+		}
+
+		// an assignment at the start of a run would have taken the last
+		// statement of the run before
+		for (size_t i = 1; i < n; i++) {
+			if (list[i]->orphan) return parse();
+		}
+
+		auto ast = this;
+		auto root = NODE_C(BlockNode);
+		for (size_t i = 0; i < n; i++) {
+			auto& nodes = cast<BlockNode>(roots[i])->nodes;
+			root->nodes.append(arena, nodes.begin(), nodes.size());
+			for (auto& d : list[i]->own.all()) sink->report(d.row, d.col, d.message);
+			index = list[i]->index;
+		}
+		parts = move(list);
+		return root;
+	}
+
+	// A declaration keyword that follows `;` or `}` outside any brace,
+	// parenthesis or bracket starts a statement, whatever came before. A
+	// `;` closes the parentheses open at its level, because the parser
+	// reports them and resumes after it. A stray `}` ends the parse, so
+	// nothing after one is a start. A source that opens with `{` is taken
+	// as one block, which the parse ends at its `}`.
+	AST::Split AST::split(Lexer* lex) {
+		auto isDeclaration = [](Token* t) {
+			return t->isKeyword(Token::tDefineFunction) || t->isKeyword(Token::tDefineStruct) ||
+				t->isKeyword(Token::tDefineImpl) || t->isKeyword(Token::tDefineInterface);
+		};
+		auto endsStatement = [](Token* t) {
+			return t->isOperator(Token::tSemicolon) || t->isOperator(Token::tRBrace);
+		};
+
+		Split c;
+		int count = lex->count();
+		if (count == 0) return c;
+		c.head = isDeclaration(lex->at(0)) && lex->at(0)->offset == 0;
+
+		// open parentheses and brackets, and those of each enclosing brace
+		int parens = 0;
+		vector<int> outer;
+		bool stray = false;
+		for (int i = 0; i < count && !stray; i++) {
+			auto t = lex->at(i);
+			if (i > 0 && outer.empty() && parens == 0 && isDeclaration(t) && endsStatement(lex->at(i - 1))) {
+				c.starts.push_back(i);
+			}
+			if (!t->isOperator()) continue;
+			switch (t->type) {
+			case Token::tLBrace:
+				if (i == 0) break;
+				outer.push_back(parens);
+				parens = 0;
+				break;
+			case Token::tRBrace:
+				if (outer.empty()) {
+					stray = true;
+					break;
+				}
+				parens = outer.back();
+				outer.pop_back();
+				break;
+			case Token::tLParen:
+			case Token::tLBracket:
+				parens++;
+				break;
+			case Token::tRParen:
+			case Token::tRBracket:
+				if (parens > 0) parens--;
+				break;
+			case Token::tSemicolon:
+				parens = 0;
+				break;
+			default:
+				break;
+			}
+		}
+		c.clean = !stray && outer.empty() && parens == 0 && !lex->unterminated() && endsStatement(lex->at(count - 1));
+		return c;
+	}
+
 
 
 
@@ -68,7 +260,11 @@ namespace Lang {
 		string end = "}";
 		string sep = ";";
 
-		if (ast->tk()->isOperator("{")) ast->index += 1;
+		bool braced = ast->tk()->isOperator("{");
+		if (braced) {
+			if (!nest(ast->tk())) return nullptr;
+			ast->index += 1;
+		}
 
 		while (ast->tk() != Token::Empty) {
 			auto t = ast->tk();
@@ -82,71 +278,77 @@ namespace Lang {
 				continue;
 			}
 
-			if (t->isKeyword("var")) {
-				nodes.push_back(NODE_P(DeclVarNode));
+			int start = ast->index;
+			auto depthCount = ast->depth;
+			auto bodyCount = ast->bodies;
+			auto n = statement(t);
+			if (ast->panic) {
+				ast->recover(start, depthCount, bodyCount);
 				continue;
 			}
+			if (n != nullptr) add(nodes, n);
+		}
+		if (braced) unnest();
+		return this;
+	}
 
-			if (t->isKeyword("const")) {
-				nodes.push_back(NODE_P(DeclConstNode));
-				continue;
-			}
+	// One statement starting at t, or nullptr when it added itself (an
+	// assignment takes over the statement before it).
+	AST::Node* AST::BlockNode::statement(Token* t) {
+		if (t->isKeyword("var")) {
+			return NODE_P(DeclVarNode);
+		}
 
-			if (t->isKeyword("if")) {
-				nodes.push_back(NODE_P(IfNode));
-				continue;
-			}
+		if (t->isKeyword("const")) {
+			return NODE_P(DeclConstNode);
+		}
 
-			if (t->isKeyword("loop")) {
-				nodes.push_back(NODE_P(LoopNode));
-				continue;
-			}
+		if (t->isKeyword("if")) {
+			return NODE_P(IfNode);
+		}
 
-			if (t->isKeyword("fn")) {
-				nodes.push_back(NODE_P(DefineFuncNode));
-				continue;
-			}
+		if (t->isKeyword("loop")) {
+			return NODE_P(LoopNode);
+		}
 
-			if (t->isKeyword("struct")) {
-				nodes.push_back(NODE_P(DefineStructNode));
-				continue;
-			}
+		if (t->isKeyword("fn")) {
+			return NODE_P(DefineFuncNode);
+		}
 
-			if (t->isKeyword("impl")) {
-				nodes.push_back(NODE_P(DefineImplNode));
-				continue;
-			}
+		if (t->isKeyword("struct")) {
+			return NODE_P(DefineStructNode);
+		}
 
-			if (t->isKeyword("interface")) {
-				nodes.push_back(NODE_P(DefineInterfaceNode));
-				continue;
-			}
+		if (t->isKeyword("impl")) {
+			return NODE_P(DefineImplNode);
+		}
 
-			if (t->isKeyword("return")) {
-				nodes.push_back(NODE_P(ReturnNode));
-				continue;
-			}
+		if (t->isKeyword("interface")) {
+			return NODE_P(DefineInterfaceNode);
+		}
 
-			if (t->isAssignOperator()) {
-				NODE_AP(AssignNode, dynamic_cast<BlockNode*>(this));
-				//parseAssign(block);
-				continue;
-			}
+		if (t->isKeyword("return")) {
+			return NODE_P(ReturnNode);
+		}
 
-			if (t->isOperator("{")) {
-				nodes.push_back(NODE_P(BlockNode));
-				continue;
-			}
-			//...
-			auto n = NODE_AP(ExpressionNode, true);
-			if (n != nullptr) {
-				nodes.push_back(n);
-				continue;
-			}
+		if (t->isAssignOperator()) {
+			//parseAssign(block);
+			return NODE_AP(AssignNode, this);
+		}
 
-			throwException(t, "unmatched statement, got `" + t->value + "`");
+		if (t->isOperator("{")) {
+			return NODE_P(BlockNode);
 		}
-		return this;
+		//...
+		auto n = NODE_AP(ExpressionNode, true);
+		if (n != nullptr) {
+			return n;
+		}
+		// the expression reported its own error; past the tokens it read,
+		// a streaming lexer no longer holds t
+		RETURN_IF_FAILED;
+
+		return error(t, "unmatched statement, got `" + t->str() + "`");
 	}
 
 	AST::Node* AST::PrimaryExprNode::parse() {
@@ -157,9 +359,6 @@ namespace Lang {
 		if (t->isIdentifier()) {
 			return NODE_P(IdentifierNode);
 		}
-		if (t->isOperator("(")) {
-			return NODE_P(ParenExprNode);
-		}
 		if (t->isKeyword("fn")) {
 			return NODE_AP(DefineFuncNode, DefineFuncNode::dfmValue);
 		}
@@ -170,27 +369,28 @@ namespace Lang {
 	}
 
 	AST::Node* AST::LiteralNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		if (!token->isLiteral()) {
-			throwException(token, "expect literal, got `" + token->value + "`");
+			return error(token, "expect literal, got `" + token->str() + "`");
 		}
 		ast->index += 1;
 		return this;
 	}
 
 	AST::Node* AST::IdentifierNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		if (!token->isIdentifier()) {
-			throwException(token, "expect identifier, got `" + token->value + "`");
+			return error(token, "expect identifier, got `" + token->str() + "`");
 		}
+		symbol = token->symbol;
 		ast->index += 1;
 		return this;
 	}
 
 	AST::Node* AST::OperatorNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		if (!token->isOperator()) {
-			throwException(token, "expect operator, got `" + token->value + "`");
+			return error(token, "expect operator, got `" + token->str() + "`");
 		}
 		ast->index += 1;
 
@@ -206,152 +406,238 @@ namespace Lang {
 		return this;
 	}
 
-	AST::Node* AST::ParenExprNode::parse() {
-		int start = ast->index;
-		
-		ast->index += 1;//(
-		auto node = NODE_P(ExpressionNode);
+	// Operands and operators are gathered into a list for climb(). A
+	// bracket inside the expression, a parenthesis, tuple, call arguments
+	// or subscript, does not recurse: the list so far is set aside while
+	// the bracket's contents are read, then taken up again with what the
+	// bracket made as its next operand. A parenthesis becomes a tuple at
+	// its first comma, so nothing is read twice.
+	AST::Node* AST::ExpressionNode::parse() {
+		enum State {
+			sOperator,
+			sPrimaryExpr,
+		};
 
-		if (ast->tk()->isOperator(",")) {
-			ast->index = start;
-			return NODE_P(TupleExprNode);
-		}
+		// an open bracket: nkParenExpr, nkTupleExpr, nkFuncCallArgs or
+		// nkSubscriptIndex, the list it interrupted and the tuple or the
+		// arguments read so far
+		struct Open {
+			Kind          kind;
+			vector<Node*> list;
+			Node*         node;
+		};
 
-		if (!ast->tk()->isOperator(")")) {
-			throwException(ast->tk(), "expect `)`, got `" + ast->tk()->value + "`");
-		}
-		ast->index += 1;//)
+		auto open = vector<Open>();
+		auto list = vector<Node*>();
+		State state = sOperator;
 
-		return node;
-	}
+		while (true) {
+			// the bracket the list stops at, nkExpression for none
+			Kind opened = nkExpression;
+			while (ast->tk() != Token::Empty) {
+				auto t = ast->tk();
+				if (t->isBinaryOperator() || t->isUnaryOperator()) {
+					if (state == sOperator && !t->convertToUnaryOperator()) return error(t, "expect unary operator, got `" + t->str() + "`");
+					list.push_back(NODE_P(OperatorNode));
+					RETURN_IF_FAILED;
+					state = sOperator;
+					continue;
+				}
+				if (t->isOperator("(") && state == sPrimaryExpr) {
+					list.push_back(NODE_C(FuncCallNode));
+					opened = nkFuncCallArgs;
+					break;
+				}
+				if (t->isOperator("[") && state == sPrimaryExpr) {
+					list.push_back(NODE_C(SubscriptNode));
+					opened = nkSubscriptIndex;
+					break;
+				}
+				if (state == sPrimaryExpr) break;
+				if (t->isOperator("(")) {
+					opened = nkParenExpr;
+					break;
+				}
+				auto expr = NODE_P(PrimaryExprNode);
+				RETURN_IF_FAILED;
+				if (expr != nullptr) {
+					list.push_back(expr);
+					state = sPrimaryExpr;
+					continue;
+				}
+				break;
+			}
 
-	AST::Node* AST::TupleExprNode::parse() {
-		ast->index += 1;//(
-		while (!ast->tk()->isOperator(")")) {
-			values.push_back(NODE_P(ExpressionNode));
-			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
-			if (ast->tk()->isOperator(")")) break;
-			throwException(ast->tk(), "expect `,` or `)`, got `" + ast->tk()->value + "`");
+			// what the bracket closing here made
+			Node* closed = nullptr;
+			if (opened != nkExpression) {
+				if (!nest(ast->tk())) return nullptr;
+				ast->index += 1;//( or [
+				open.push_back({ opened, move(list), opened == nkFuncCallArgs ? NODE_C(FuncCallArgsNode) : nullptr });
+				list.clear();
+				state = sOperator;
+				if (opened != nkFuncCallArgs || !ast->tk()->isOperator(")")) continue;
+				closed = open.back().node;
+			} else {
+				// the expression ends, or an element of the innermost bracket
+				if (list.empty()) {
+					if (open.empty() && enableEmpty) return nullptr;
+					return error(ast->tk(), "expect expression, got `" + ast->tk()->str() + "`");
+				}
+				if (state == sOperator) {
+					return error(list.back()->token, "incomplete expression, end with `" + list.back()->token->str() + "`");
+				}
+				auto node = climb(list);
+				RETURN_IF_FAILED;
+				if (open.empty()) return node;
+
+				auto& o = open.back();
+				auto t = ast->tk();
+				if (o.kind == nkParenExpr && t->isOperator(",")) {
+					o.kind = nkTupleExpr;
+					o.node = NODE_C(TupleExprNode);
+				}
+				if (o.kind == nkParenExpr) {
+					if (!t->isOperator(")")) return error(t, "expect `)`, got `" + t->str() + "`");
+					closed = node;
+				} else if (o.kind == nkSubscriptIndex) {
+					if (!t->isOperator("]")) return error(t, "expect `]`, got `" + t->str() + "`");
+					closed = node;
+				} else {
+					auto& items = o.kind == nkTupleExpr ? cast<TupleExprNode>(o.node)->values : cast<FuncCallArgsNode>(o.node)->nodes;
+					add(items, (ExpressionNode*)node);
+					if (t->isOperator(",")) {
+						ast->index += 1;//,
+						if (!ast->tk()->isOperator(")")) {
+							list.clear();
+							state = sOperator;
+							continue;
+						}
+					} else if (!t->isOperator(")")) {
+						return error(t, "expect `,` or `)`, got `" + t->str() + "`");
+					}
+					closed = o.node;
+				}
+			}
+			ast->index += 1;//) or ]
+			unnest();
+			list = move(open.back().list);
+			open.pop_back();
+			list.push_back(closed);
+			state = sPrimaryExpr;
 		}
-		ast->index += 1;//)
-		return this;
 	}
 
-	AST::Node* AST::FuncCallArgsNode::parse() {
-		ast->index += 1;//(
-		while (!ast->tk()->isOperator(")")) {
-			nodes.push_back(NODE_P(ExpressionNode));
-			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
-			if (ast->tk()->isOperator(")")) break;
-			throwException(ast->tk(), "expect `,` or `)`, got `" + ast->tk()->value + "`");
+	namespace {
+		// an operator still waiting for operands, or nullptr for an operand
+		AST::OperatorNode* pending(AST::Node* n) {
+			auto op = dyn_cast<AST::OperatorNode>(n);
+			return op != nullptr && op->empty() ? op : nullptr;
 		}
-		ast->index += 1;//)
-		return this;
-	}
-
-	AST::Node* AST::SubscriptIndexNode::parse() {
-		ast->index += 1;//[
-
-		auto expr = NODE_P(ExpressionNode);
 
-		if (!ast->tk()->isOperator("]")) {
-			throwException(ast->tk(), "expect `]`, got `" + ast->tk()->value + "`");
+		bool isUnary(AST::Node* n) {
+			auto op = pending(n);
+			return op != nullptr && op->token->isUnaryOperator();
 		}
-		ast->index += 1;//]
-
-		return expr;
 	}
 
-	AST::Node* AST::ExpressionNode::parse() {
-		enum State {
-			sOperator,
-			sPrimaryExpr,
+	// Precedence climbing over the alternating operand/operator list, in one
+	// left-to-right pass. It gives the same trees as the earlier split at the
+	// loosest operator, including its quirk that a unary operator standing
+	// after an operand (`a ! b`) or after `.` (`a . -b`) discards the chain
+	// of tighter operators to its left.
+	//
+	// Instead of recursing for the operand on the right of an operator, the
+	// operator is stacked with its left operand and the binding it had, and
+	// taken off to be given both once that operand is complete, so a chain
+	// of unary or right-associative operators takes no stack.
+	AST::Node* AST::ExpressionNode::climb(const vector<Node*>& list) {
+		struct Frame {
+			OperatorNode* op;
+			// nullptr when op is unary
+			Node*         left;
+			int           minPriority;
 		};
 
-		auto list = vector<Node*>();
-		State state = sOperator;
+		auto frames = vector<Frame>();
+		int minPriority = 0;
+		size_t i = 0;
+		Node* left = nullptr;
 
-		while (ast->tk() != Token::Empty) {
-			auto t = ast->tk();
-			if (t->isBinaryOperator() || t->isUnaryOperator()) {
-				if (state == sOperator && !t->convertToUnaryOperator()) throwException(t, "expect unary operator, got `" + t->value + "`");
-				list.push_back(NODE_P(OperatorNode));
-				state = sOperator;
-				continue;
-			}
-			if (t->isOperator("(") && state == sPrimaryExpr) {
-				list.push_back(NODE_C(FuncCallNode));
-				list.push_back(NODE_P(FuncCallArgsNode));
-				state = sPrimaryExpr;
-				continue;
+		while (true) {
+			if (left == nullptr) {
+				while (isUnary(list[i])) {
+					frames.push_back({ pending(list[i]), nullptr, minPriority });
+					minPriority = UnaryPriority;
+					i++;
+				}
+				left = list[i++];
 			}
-			if (t->isOperator("[") && state == sPrimaryExpr) {
-				list.push_back(NODE_C(SubscriptNode));
-				list.push_back(NODE_P(SubscriptIndexNode));
-				state = sPrimaryExpr;
-				continue;
+
+			bool operand = false;
+			while (i < list.size()) {
+				auto op = pending(list[i]);
+				auto t = op->token;
+				bool unary = t->isUnaryOperator();
+				if (!unary && t->getPriority() > UnaryPriority && i + 1 < list.size() && isUnary(list[i + 1])) {
+					if (UnaryPriority < minPriority) break;
+					i++;
+					op = pending(list[i]);
+					unary = true;
+				}
+				if (unary) {
+					if (UnaryPriority < minPriority) break;
+					i++;
+					frames.push_back({ op, nullptr, minPriority });
+					minPriority = UnaryPriority;
+					operand = true;
+					break;
+				}
+				if (!t->isBinaryOperator()) {
+					return op->error(t, "unexpected operator `" + t->str() + "`");
+				}
+
+				int priority = t->getPriority();
+				if (priority < minPriority) break;
+				i++;
+				frames.push_back({ op, left, minPriority });
+				minPriority = Operators[t->type].assoc == OperatorInfo::aRight ? priority : priority + 1;
+				operand = true;
+				break;
 			}
-			if (state == sPrimaryExpr) break;
-			auto expr = NODE_P(PrimaryExprNode);
-			if (expr != nullptr) {
-				list.push_back(expr);
-				state = sPrimaryExpr;
+			if (operand) {
+				left = nullptr;
 				continue;
 			}
-			break;
-		}
-		if (list.empty()) {
-			if (enableEmpty) return nullptr;
-			throwException(ast->tk(), "expect expression, got `" + ast->tk()->value + "`");
-		}
-		if (state == sOperator) {
-			throwException(list.back()->token, "incomplete expression, end with `" + list.back()->token->value + "`");
-		}
-		return buildTree(list, 0, list.size() - 1);
-	}
-
-	AST::Node* AST::ExpressionNode::buildTree(vector<Node*> list, int begin, int end) {
-		int opi = -1;
-		int priority = 99;
-		for (auto i = begin; i <= end; i++) {
-			auto n = dynamic_cast<OperatorNode*>(list[i]);
-			if (n == nullptr || !n->empty()) continue;
-			auto t = n->token;
-			if (t->isAssignOperator() && t->getPriority() <  priority ||
-				t->isUnaryOperator()  && t->getPriority() <  priority ||
-				t->isBinaryOperator() && t->getPriority() <= priority && !t->isAssignOperator())
-			{
-				opi = i;
-				priority = t->getPriority();
-			}
-		}
-		if (opi != -1) {
-			auto op = list[opi];
-			if (op->token->isBinaryOperator()) {
-				dynamic_cast<BinaryOperatorNode*>(op)->addNodes(buildTree(list, begin, opi - 1), buildTree(list, opi + 1, end));
-			} else if (op->token->isUnaryOperator()) {
-				dynamic_cast<UnaryOperatorNode*>(op)->addNode(buildTree(list, opi + 1, end));
+
+			// left is complete, as the operand of the last operator stacked
+			if (frames.empty()) return left;
+			auto f = frames.back();
+			frames.pop_back();
+			if (f.left == nullptr) {
+				cast<UnaryOperatorNode>(f.op)->addNode(left);
 			} else {
-				//error
-				throwException(op->token, "unexpected operator `" + op->token->value + "`");
+				cast<BinaryOperatorNode>(f.op)->addNodes(f.left, left);
 			}
-			return op;
+			left = f.op;
+			minPriority = f.minPriority;
 		}
-		return list[begin];
 	}
 
 	AST::Node* AST::DeclVarNode::parse() {
 		ast->index += 1;//var
 
 		this->name = NODE_P(IdentifierNode);
+		RETURN_IF_FAILED;
 
 		if (!ast->tk()->isOperator(":") && !(!inLoop && ast->tk()->isOperator("=")) && !(inLoop && ast->tk()->isKeyword("in"))) {
-			throwException(name->token, "cannot determine the type of variable `" + name->token->value + "`");
+			return error(name->token, "cannot determine the type of variable `" + name->token->str() + "`");
 		}
 
 		if (ast->tk()->isOperator(":")) {
 			ast->index += 1;//:
 			this->type = NODE_P(TypeNode);
+			RETURN_IF_FAILED;
 		} else {
 			//type=nullptr
 		}
@@ -363,72 +649,86 @@ namespace Lang {
 		ast->index += 1;
 
 		name = NODE_P(IdentifierNode);
+		RETURN_IF_FAILED;
 
 		if (ast->tk()->isOperator(":")) {
 			ast->index += 1;//:
 			this->type = NODE_P(TypeNode);
+			RETURN_IF_FAILED;
 		} else {
 			//type=nullptr
 		}
 
 		if (!(!inLoop && ast->tk()->isOperator("=")) && !(inLoop && ast->tk()->isKeyword("in"))) {
-			throwException(name->token, "constant value required");
+			return error(name->token, "constant value required");
 		}
 
 		return this;
 	}
 
 	AST::Node* AST::AssignNode::parse() {
-		if (block->nodes.empty()) throwException(ast->tk(), "lvalue not found");
+		if (block->nodes.empty()) {
+			ast->orphan = true;
+			return error(ast->tk(), "lvalue not found");
+		}
 
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//=
 
 		//auto lv = block->nodes.back();
 		//if (!lv->token->isIdentifier() &&
 		//	!lv->token->isKeyword("var") &&
-		//	!lv->token->isKeyword("const")) throwException(tk(), "invalid lvalue");
+		//	!lv->token->isKeyword("const")) return error(tk(), "invalid lvalue");
 
 		node = block->nodes.back();
 		block->nodes[block->nodes.size() - 1] = this;
 		value = NODE_P(ExpressionNode);
+		RETURN_IF_FAILED;
 		
 		return nullptr;
 	}
 
 	AST::Node* AST::ReturnNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//return
 
 		value = NODE_AP(ExpressionNode, true);
+		RETURN_IF_FAILED;
 
 		return this;
 	}
 
 	AST::Node* AST::TupleTypeNode::parse() {
+		if (!nest(ast->tk())) return nullptr;
 		ast->index += 1;//(
 		while (!ast->tk()->isOperator(")")) {
-			types.push_back(NODE_P(TypeNode));
+			add(types, NODE_P(TypeNode));
+			RETURN_IF_FAILED;
 			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator(")")) break;
-			throwException(ast->tk(), "expect `,` or `)`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `,` or `)`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//)
+		unnest();
 		return this;
 	}
 
 	AST::Node* AST::TypeNameNode::parse() {
 		if (ast->tk()->isIdentifier()) {
 			name = NODE_P(IdentifierNode);
+			RETURN_IF_FAILED;
 			if (ast->tk()->isOperator("<")) {
+				if (!nest(ast->tk())) return nullptr;
 				ast->index += 1;//<
 				while (!ast->tk()->isOperator(">")) {
-					genericTypes.push_back(NODE_P(TypeNode));
+					add(genericTypes, NODE_P(TypeNode));
+					RETURN_IF_FAILED;
 					if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 					if (ast->tk()->isOperator(">")) break;
-					throwException(ast->tk(), "expect `,` or `>`, got `" + ast->tk()->value + "`");
+					return error(ast->tk(), "expect `,` or `>`, got `" + ast->tk()->str() + "`");
 				}
 				ast->index += 1; //>
+				unnest();
 			}
 			return this;
 		}
@@ -439,8 +739,7 @@ namespace Lang {
 			return NODE_AP(DefineFuncNode, DefineFuncNode::dfmType);
 		}
 
-		throwException(ast->tk(), "expect type name, got `" + ast->tk()->value + "`");
-		return nullptr;
+		return error(ast->tk(), "expect type name, got `" + ast->tk()->str() + "`");
 	}
 
 	AST::Node* AST::TypeNode::parse() {
@@ -450,20 +749,21 @@ namespace Lang {
 		}
 
 		name = NODE_P(TypeNameNode);
+		RETURN_IF_FAILED;
 
 		//ֶ֧ά飬÷
 		if (ast->tk()->isOperator("[")) {
 			isArray = true;
 			ast->index += 1;//[
 			if (ast->tk()->isLiteral(Token::Type::tInteger)) {
-				arrayLength = atoi(ast->tk()->value.c_str());
+				arrayLength = atoi(ast->tk()->str().c_str());
 				if (arrayLength < 0) {
-					throwException(ast->tk(), "expect positive integer, got `" + ast->tk()->value + "`");
+					return error(ast->tk(), "expect positive integer, got `" + ast->tk()->str() + "`");
 				}
 				ast->index += 1;//number
 			}
 			if (!ast->tk()->isOperator("]")) {
-				throwException(ast->tk(), "expect `]`, got `" + ast->tk()->value + "`");
+				return error(ast->tk(), "expect `]`, got `" + ast->tk()->str() + "`");
 			}
 			ast->index += 1;//]
 		}
@@ -482,120 +782,143 @@ namespace Lang {
 		}
 
 		name = NODE_P(IdentifierNode);
+		RETURN_IF_FAILED;
 
 		if (!ast->tk()->isOperator(":")) {
-			throwException(ast->tk(), "expect `:`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `:`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//:
 
 		type = NODE_P(TypeNode);
+		RETURN_IF_FAILED;
 
 		//default value
 		if (ast->tk()->isOperator("=")) {
 			ast->index += 1;//=
 			defaultValue = NODE_P(ExpressionNode);
+			RETURN_IF_FAILED;
 		}
 
 		return this;
 	}
 
+	// `else if` arms are read by this loop, each into the elseBlock of the
+	// arm before, so a long chain takes no stack
 	AST::Node* AST::IfNode::parse() {
-		token = ast->tk();
-		ast->index += 1;//if
+		for (auto arm = this;;) {
+			arm->token = ast->take();
+			ast->index += 1;//if
 
-		condExpr = NODE_P(ExpressionNode);
+			arm->condExpr = NODE_P(ExpressionNode);
+			RETURN_IF_FAILED;
 
-		if (!ast->tk()->isOperator("{")) {
-			throwException(ast->tk(), "expect `{`, got `" + ast->tk()->value + "`");
-		}
+			if (!ast->tk()->isOperator("{")) {
+				return error(ast->tk(), "expect `{`, got `" + ast->tk()->str() + "`");
+			}
 
-		ifBlock = NODE_P(BlockNode);
+			arm->ifBlock = NODE_P(BlockNode);
+			RETURN_IF_FAILED;
 
-		if (ast->tk()->isKeyword("else")) {
+			if (!ast->tk()->isKeyword("else")) break;
 			ast->index += 1;//else
 			if (ast->tk()->isKeyword("if")) {
-				elseBlock = NODE_P(IfNode);
+				auto next = NODE_C(IfNode);
+				arm->elseBlock = next;
+				arm = next;
+				continue;
 			}
 			else if (ast->tk()->isOperator("{")) {
-				elseBlock = NODE_P(BlockNode);
+				arm->elseBlock = NODE_P(BlockNode);
+				RETURN_IF_FAILED;
 			}
 			else {
-				throwException(ast->tk(), "expect `{` or `if`, got `" + ast->tk()->value + "`");
+				return error(ast->tk(), "expect `{` or `if`, got `" + ast->tk()->str() + "`");
 			}
+			break;
 		}
 
 		return this;
 	}
 
 	AST::Node* AST::LoopNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//loop
 
 		if (ast->tk()->isOperator("{")) {
 			block = NODE_P(BlockNode);
+			RETURN_IF_FAILED;
 		}
 		else if (ast->tk()->isKeyword("if")) {
 			block = NODE_P(IfNode);
+			RETURN_IF_FAILED;
 
 			Node* elseNode = block;
 			do {
-				elseNode = dynamic_cast<IfNode*>(elseNode)->elseBlock;
+				elseNode = cast<IfNode>(elseNode)->elseBlock;
 				if (elseNode == nullptr) elseNode = NODE_C(BlockNode);
 			} while (elseNode->token && elseNode->token->isKeyword("if"));
-			dynamic_cast<BlockNode*>(elseNode)->nodes.push_back(NODE_C(BreakNode));
+			add(cast<BlockNode>(elseNode)->nodes, NODE_C(BreakNode));
 		}
 		else if (ast->tk()->isKeyword("each")) {
 			block = NODE_P(EachNode);
+			RETURN_IF_FAILED;
 		}
 		else {
-			throwException(ast->tk(), "expect `{` or `if` or `each`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `{` or `if` or `each`, got `" + ast->tk()->str() + "`");
 		}
 
 		return this;
 	}
 
 	AST::Node* AST::EachNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//each
 
 		if (ast->tk()->isIdentifier()) {
 			each = NODE_P(IdentifierNode);
+			RETURN_IF_FAILED;
 		}
 		else if (ast->tk()->isKeyword("var")) {
 			each = NODE_AP(DeclVarNode, true);
+			RETURN_IF_FAILED;
 		}
 		else if (ast->tk()->isKeyword("const")) {
 			each = NODE_AP(DeclConstNode, true);
+			RETURN_IF_FAILED;
 		}
 		else {
-			throwException(ast->tk(), "expect `var` or `const` or identifier, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `var` or `const` or identifier, got `" + ast->tk()->str() + "`");
 		}
 
 		if (!ast->tk()->isKeyword("in")) {
-			throwException(ast->tk(), "expect `in`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `in`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//in
 
 		in = NODE_P(ExpressionNode);
+		RETURN_IF_FAILED;
 
 		if (!ast->tk()->isOperator("{")) {
-			throwException(ast->tk(), "expect `{`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `{`, got `" + ast->tk()->str() + "`");
 		}
 
 		block = NODE_P(BlockNode);
+		RETURN_IF_FAILED;
 
 		return this;
 	}
 
 	AST::Node* AST::DefineNameNode::parse() {
 		name = NODE_P(IdentifierNode);
+		RETURN_IF_FAILED;
 		if (ast->tk()->isOperator("<")) {
 			ast->index += 1;//<
 			while (!ast->tk()->isOperator(">")) {
-				genericNames.push_back(NODE_P(IdentifierNode));
+				add(genericNames, NODE_P(IdentifierNode));
+				RETURN_IF_FAILED;
 				if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 				if (ast->tk()->isOperator(">")) break;
-				throwException(ast->tk(), "expect `,` or `>`, got `" + ast->tk()->value + "`");
+				return error(ast->tk(), "expect `,` or `>`, got `" + ast->tk()->str() + "`");
 			}
 			ast->index += 1;//>
 		}
@@ -603,37 +926,43 @@ namespace Lang {
 	}
 
 	AST::Node* AST::DefineFuncNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//fn
 
 		//name
 		if ((mode == dfmNormal || mode == dfmInterface) && ast->tk()->isIdentifier()) {
 			name = NODE_P(DefineNameNode);
+			RETURN_IF_FAILED;
 		}
 
 		if (!ast->tk()->isOperator("(")) {
-			throwException(ast->tk(), "expect `(`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `(`, got `" + ast->tk()->str() + "`");
 		}
+		if (!nest(ast->tk())) return nullptr;
 		ast->index += 1;//(
 
 		while (!ast->tk()->isOperator(")")) {
-			args.push_back(NODE_P(FieldNode));
+			add(args, NODE_P(FieldNode));
+			RETURN_IF_FAILED;
 			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator(")")) break;
-			throwException(ast->tk(), "expect `,` or `)`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `,` or `)`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//)
+		unnest();
 
 		if (ast->tk()->isOperator("->")) {
 			ast->index += 1;//->
 			returnType = NODE_P(TypeNode);
+			RETURN_IF_FAILED;
 		}
 
 		if ((mode == dfmNormal || mode == dfmInterface || mode == dfmValue) && ast->tk()->isOperator("{")) {
 			block = NODE_P(BlockNode);
+			RETURN_IF_FAILED;
 		} else {
 			if (mode != dfmInterface && mode != dfmType) {
-				throwException(ast->tk(), "expect `{`, got `" + ast->tk()->value + "`");
+				return error(ast->tk(), "expect `{`, got `" + ast->tk()->str() + "`");
 			}
 		}
 
@@ -641,84 +970,97 @@ namespace Lang {
 	}
 
 	AST::Node* AST::DefineStructNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//struct
 
 		name = NODE_P(DefineNameNode);
+		RETURN_IF_FAILED;
 
 		if (!ast->tk()->isOperator("{")) {
-			throwException(ast->tk(), "expect `{`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `{`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//{
+		ast->bodies += 1;
 
 		while (!ast->tk()->isOperator("}")) {
-			fields.push_back(NODE_P(FieldNode));
+			add(fields, NODE_P(FieldNode));
+			RETURN_IF_FAILED;
 			if (ast->tk()->isOperator(";")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator("}")) break;
-			throwException(ast->tk(), "expect field name, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect field name, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//}
+		ast->bodies -= 1;
 
 		return this;
 	}
 
 	AST::Node* AST::DefineImplNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//impl
 
 		name = NODE_P(DefineNameNode);
+		RETURN_IF_FAILED;
 
 		//interface
 		if (ast->tk()->isOperator(":")) {
 			ast->index += 1;//:
 			iface = NODE_P(DefineNameNode);
+			RETURN_IF_FAILED;
 		}
 
 		if (!ast->tk()->isOperator("{")) {
-			throwException(ast->tk(), "expect `{`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `{`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//{
+		ast->bodies += 1;
 
 		while (!ast->tk()->isOperator("}")) {
-			funcs.push_back(NODE_P(DefineFuncNode));
+			add(funcs, NODE_P(DefineFuncNode));
+			RETURN_IF_FAILED;
 			if (ast->tk()->isOperator(";")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator("}")) break;
 			if (!ast->tk()->isKeyword("fn")) {
-				throwException(ast->tk(), "expect function definition, got `" + ast->tk()->value + "`");
+				return error(ast->tk(), "expect function definition, got `" + ast->tk()->str() + "`");
 			}
 		}
 		ast->index += 1;//}
+		ast->bodies -= 1;
 
 		return this;
 	}
 
 	AST::Node* AST::DefineInterfaceNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//interface
 
 		name = NODE_P(DefineNameNode);
+		RETURN_IF_FAILED;
 
 		if (!ast->tk()->isOperator("{")) {
-			throwException(ast->tk(), "expect `{`, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect `{`, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//{
+		ast->bodies += 1;
 
 		while (!ast->tk()->isOperator("}")) {
-			funcs.push_back(NODE_AP(DefineFuncNode, DefineFuncNode::dfmInterface));
+			add(funcs, NODE_AP(DefineFuncNode, DefineFuncNode::dfmInterface));
+			RETURN_IF_FAILED;
 			if (ast->tk()->isOperator(";")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator(",")) { ast->index += 1; continue; }
 			if (ast->tk()->isOperator("}")) break;
-			throwException(ast->tk(), "expect function definition, got `" + ast->tk()->value + "`");
+			return error(ast->tk(), "expect function definition, got `" + ast->tk()->str() + "`");
 		}
 		ast->index += 1;//}
+		ast->bodies -= 1;
 
 		return this;
 	}
 
 	AST::Node* AST::BreakNode::parse() {
-		token = ast->tk();
+		token = ast->take();
 		ast->index += 1;//break
 
 		return this;
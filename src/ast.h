@@ -1,81 +1,250 @@
 #pragma once
 
+#include <climits>
+#include <memory>
 #include <string>
 #include <vector>
-#include <list>
 #include <iostream>
 #include "token.h"
 #include "lexer.h"
+#include "arena.h"
 
 using namespace std;
 
 namespace Lang {
+	// Checked downcasts on the node kind, in the manner of LLVM's: isa<T>
+	// asks T::classof, cast<T> is for when the kind is already known and
+	// dyn_cast<T> yields nullptr on a mismatch. All three accept nullptr.
+	// N is left open so the nodes' own inline members can use them.
+	template <class T, class N>
+	inline bool isa(const N* n) {
+		return n != nullptr && T::classof(n);
+	}
+
+	template <class T, class N>
+	inline T* cast(N* n) {
+		return static_cast<T*>(n);
+	}
+
+	template <class T, class N>
+	inline T* dyn_cast(N* n) {
+		return isa<T>(n) ? static_cast<T*>(n) : nullptr;
+	}
+
+	class WorkPool;
+
 	class AST {
 	public:
 		class Node;
 	private:
 		Lexer*       lex   = nullptr;
 		int          index = 0;
-		list<Node*>  nodes = list<Node*>();
+		// tokens from here on read as Token::Empty, so a part stops at the
+		// end of its window
+		int          end   = INT_MAX;
+		// blocks and brackets open around the current token
+		int          depth = 0;
+		// every node of this parse, freed with the AST
+		Arena        arena;
+		// an error was reported and the statement is being abandoned
+		bool         panic = false;
+		// struct, impl and interface bodies entered and not yet closed
+		int          bodies = 0;
+		// an assignment found no statement before it in its block
+		bool         orphan = false;
+		// where errors go: the lexer's list, or a part's own until the
+		// parts are put together
+		Diagnostics* sink   = nullptr;
+		Diagnostics  own;
+		// parses of token windows whose nodes the root took over, kept for
+		// their arenas
+		vector<unique_ptr<AST>> parts;
+
+		void recover(int start, int depthCount, int bodyCount);
 	public:
-		stringstream printBuf;
+		// changes whenever a source may parse to a different tree, so trees
+		// saved by an older parser are not taken for this one's
+		static constexpr unsigned Version = 1;
+		static constexpr int      DefaultMaxDepth = 1000;
+
+		// How deep blocks, brackets, parameter lists and type arguments may
+		// nest; the parse reports the first one deeper, 0 for no limit.
+		// Blocks and types are parsed by recursion and so need it. Operator
+		// and `else if` chains are parsed without recursion and are not
+		// limited, so a tree may be deeper than this; the passes over it
+		// (writeTree, flatten, the resolver, NodeVisitor::visitTree) keep
+		// their own stacks for that reason.
+		int maxDepth = DefaultMaxDepth;
 
 	public:
 		AST(Lexer* l) {
 			lex = l;
+			if (lex != nullptr) sink = &lex->diagnostics();
 		}
 
-		~AST() {
-			for (auto node : nodes) delete node;
-		}
+		AST(const AST&) = delete;
+		AST& operator=(const AST&) = delete;
 
 		Token* tk(int offset = 0);
+		// the current token for a node to keep; copied out of the lookahead
+		// window when streaming so it lives as long as the AST
+		Token* take();
 
 		Node* parse();
+		// Like parse(), but runs of top-level declarations are parsed at the
+		// same time on pool, each run into an arena of its own, and put
+		// together in source order. The tree and the diagnostics are those
+		// of parse(). A streaming lexer is parsed serially. Not to be called
+		// from a task of pool.
+		Node* parse(WorkPool& pool);
+
+		// Where the parser is between top-level statements whatever came
+		// before, judged from the tokens alone.
+		struct Split {
+			// token indexes at which a declaration starts such a statement,
+			// after the first token
+			vector<int> starts;
+			// the source itself starts with a declaration
+			bool        head  = false;
+			// the source ends between statements, so another may follow
+			bool        clean = false;
+		};
+		static Split split(Lexer* lex);
+
+		// an assignment had nothing to take; parsed after another source
+		// it would have taken that one's last statement
+		bool orphaned() const {
+			return orphan;
+		}
+
+		// what the nodes and tokens of this parse took from the arenas, in
+		// bytes and in blocks of heap, parts included
+		void memory(size_t& bytes, size_t& blocks) const {
+			bytes += arena.bytes();
+			blocks += arena.blocks();
+			for (auto& p : parts) p->memory(bytes, blocks);
+		}
+
+		// errors of this parse, after those of the lexer
+		Diagnostics& diagnostics() {
+			return lex->diagnostics();
+		}
 	public:
 		template<class T, class... TS>
 		T* createNode(TS&&... args) {
-			auto obj = new T(forward<TS>(args)...);
+			static_assert(is_trivially_destructible<T>::value, "a node is not destroyed with its arena");
+			auto obj = arena.make<T>(forward<TS>(args)...);
 			static_cast<Node*>(obj)->ast = this;
-			this->nodes.push_back(obj);
 			return obj;
 		}
 
+		// a token that lives as long as this AST, for trees not read from
+		// a lexer
+		Token* createToken(const Token& t) {
+			return arena.make<Token>(t);
+		}
+
 		class Node {
 		public:
-			AST*   ast      = nullptr;
-			Token* token    = nullptr;
-			string typeName = "";
+			// One tag per concrete node class; classes with subclasses own a
+			// contiguous range so classof is a range check.
+			enum Kind : unsigned char {
+				nkLiteral,
+				nkIdentifier,
+
+				nkOperator,
+				nkBinaryOperator,
+				nkFuncCall,
+				nkSubscript,
+				nkUnaryOperator,
+
+				nkBlock,
+				nkIf,
+				nkLoop,
+				nkEach,
+				nkDefineFunc,
+
+				nkTypeName,
+				nkType,
+				nkExpression,
+				nkFuncCallArgs,
+				nkSubscriptIndex,
+				nkPrimaryExpr,
+				nkParenExpr,
+				nkTupleExpr,
+				nkTupleType,
+				nkDeclVar,
+				nkDeclConst,
+				nkAssign,
+				nkReturn,
+				nkField,
+				nkBreak,
+				nkDefineName,
+				nkDefineStruct,
+				nkDefineImpl,
+				nkDefineInterface,
+			};
 
-			virtual ~Node() {};
+			const Kind  kind;
+			AST*        ast      = nullptr;
+			Token*      token    = nullptr;
+			const char* typeName = "";
 
-			Node* setTypeName(string name) { 
+			// Nodes are freed with their AST's arena and never destroyed, so
+			// every node class is trivially destructible, lists included.
+			Node(Kind k) : kind(k) {}
+
+			Node* setTypeName(const char* name) { 
 				typeName = name;
 				return this;
 			}
 
 			virtual Node* parse() = 0;
 			virtual Node* eval() { return nullptr; };
-			virtual void  print();
+
+			Node* error(Token* t, string e);
+			// enters a block or bracket opened at t, false and an error when
+			// that goes past ast->maxDepth
+			bool  nest(Token* t);
+			void  unnest() { ast->depth--; }
+
+			// appends to one of this node's lists, in its AST's arena
+			template<class T, class V>
+			void  add(ArenaList<T>& list, V item) { list.push_back(ast->arena, item); }
 		};
 
 		
 		class LiteralNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkLiteral; }
+
+			LiteralNode() : Node(nkLiteral) {}
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class IdentifierNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkIdentifier; }
+
+			IdentifierNode() : Node(nkIdentifier) {}
+			Symbol symbol = 0;
+			// what the name refers to, set by Resolver: a DeclVarNode,
+			// DeclConstNode, FieldNode, DefineFuncNode, DefineStructNode,
+			// DefineInterfaceNode or DefineImplNode (for self), or the
+			// IdentifierNode of a generic name. A declaring name refers to
+			// its own declaration; nullptr when nothing in the source
+			// declares it.
+			Node*  decl   = nullptr;
+
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class OperatorNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind >= nkOperator && n->kind <= nkUnaryOperator; }
+
+			OperatorNode(Kind k = nkOperator) : Node(k) {}
 			Node* parse() override;
-			void  print() override;
 
 			virtual bool empty() {
 				return false;
@@ -84,6 +253,9 @@ namespace Lang {
 
 		class BinaryOperatorNode : public OperatorNode {
 		public:
+			static bool classof(const Node* n) { return n->kind >= nkBinaryOperator && n->kind <= nkSubscript; }
+
+			BinaryOperatorNode(Kind k = nkBinaryOperator) : OperatorNode(k) {}
 			Node* left  = nullptr;
 			Node* right = nullptr;
 
@@ -93,7 +265,6 @@ namespace Lang {
 			}
 
 			Node* parse() override { return nullptr; };
-			void  print() override;
 
 			bool empty() override {
 				return left == nullptr && right == nullptr;
@@ -102,6 +273,9 @@ namespace Lang {
 
 		class UnaryOperatorNode : public OperatorNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkUnaryOperator; }
+
+			UnaryOperatorNode() : OperatorNode(nkUnaryOperator) {}
 			Node* node = nullptr;
 
 			virtual void addNode(Node* _node) {
@@ -109,7 +283,6 @@ namespace Lang {
 			}
 
 			Node* parse() override { return nullptr; };
-			void  print() override;
 
 			bool empty() override {
 				return node == nullptr;
@@ -118,89 +291,113 @@ namespace Lang {
 
 		class ScopeNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind >= nkBlock && n->kind <= nkDefineFunc; }
+
+			ScopeNode(Kind k) : Node(k) {}
 			Node* outerScope = nullptr;
 		};
 
 		class BlockNode : public ScopeNode {
 		public:
-			vector<Node*> nodes = vector<Node*>();
+			static bool classof(const Node* n) { return n->kind == nkBlock; }
+
+			BlockNode() : ScopeNode(nkBlock) {}
+			ArenaList<Node*> nodes;
 
 			Node* parse() override;
-			void  print() override;
+
+		private:
+			Node* statement(Token* t);
 		};
 
 		class TypeNode;
 		class TypeNameNode : public Node {
 		public:
-			IdentifierNode*   name         = nullptr;
-			vector<TypeNode*> genericTypes = vector<TypeNode*>();
+			static bool classof(const Node* n) { return n->kind == nkTypeName; }
+
+			TypeNameNode() : Node(nkTypeName) {}
+			IdentifierNode*      name         = nullptr;
+			ArenaList<TypeNode*> genericTypes;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class TypeNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkType; }
+
+			TypeNode() : Node(nkType) {}
 			bool          isRef       = false;
 			TypeNameNode* name        = nullptr;
 			bool          isArray     = false;
 			int           arrayLength = 0;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class ExpressionNode : public Node {
 		private:
 			bool enableEmpty = false;
 		public:
-			ExpressionNode(bool _enableEmpty = false) {
+			static bool classof(const Node* n) { return n->kind == nkExpression; }
+
+			ExpressionNode(bool _enableEmpty = false) : Node(nkExpression) {
 				enableEmpty = _enableEmpty;
 			}
 
 			Node* parse() override;
 
-			static Node* buildTree(vector<Node*> list, int begin, int end);
+			static Node* climb(const vector<Node*>& list);
 		};
 
 		class FuncCallArgsNode : public Node {
 		public:
-			vector<ExpressionNode*> nodes = vector<ExpressionNode*>();
+			static bool classof(const Node* n) { return n->kind == nkFuncCallArgs; }
 
-			Node* parse() override;
-			void  print() override;
+			FuncCallArgsNode() : Node(nkFuncCallArgs) {}
+			ArenaList<ExpressionNode*> nodes;
+
+			// read by ExpressionNode::parse with the expression around it
+			Node* parse() override { return nullptr; };
 		};
 
 		class FuncCallNode : public BinaryOperatorNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkFuncCall; }
+
 			Node*             func = nullptr;
 			FuncCallArgsNode* args = nullptr;
 
-			FuncCallNode() {
-				token = new Token(Token::Kind::kOperator, Token::Type::tFnCall, "_FNCALL_", 0, 0);
+			static Token Synthetic;
+
+			FuncCallNode() : BinaryOperatorNode(nkFuncCall) {
+				token = &Synthetic;
 			}
 
 			void addNodes(Node* _left, Node* _right) override {
 				left = _left;
 				right = _right;
 				func = _left;
-				args = dynamic_cast<FuncCallArgsNode*>(_right);
+				args = dyn_cast<FuncCallArgsNode>(_right);
 			}
 
 			bool empty() override {
 				return func == nullptr && args == nullptr;
 			}
 
-			void print() override;
 		};
 
 		class SubscriptNode : public BinaryOperatorNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkSubscript; }
+
 			Node* node = nullptr;
 			Node* index = nullptr;
 
-			SubscriptNode() {
-				token = new Token(Token::Kind::kOperator, Token::Type::tSubscript, "_SUBSCRIPT_", 0, 0);
+			static Token Synthetic;
+
+			SubscriptNode() : BinaryOperatorNode(nkSubscript) {
+				token = &Synthetic;
 			}
 
 			void addNodes(Node* _left, Node* _right) override {
@@ -214,38 +411,53 @@ namespace Lang {
 				return node == nullptr && index == nullptr;
 			}
 
-			void print() override;
 		};
 
 		class SubscriptIndexNode : public Node {
 		public:
-			Node* parse() override;
+			static bool classof(const Node* n) { return n->kind == nkSubscriptIndex; }
+
+			SubscriptIndexNode() : Node(nkSubscriptIndex) {}
+			// read by ExpressionNode::parse with the expression around it
+			Node* parse() override { return nullptr; };
 		};
 
 		class PrimaryExprNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkPrimaryExpr; }
+
+			PrimaryExprNode() : Node(nkPrimaryExpr) {}
 			Node* parse() override;
 		};
 
 		class ParenExprNode : public Node {
 		public:
-			Node* parse() override;
+			static bool classof(const Node* n) { return n->kind == nkParenExpr; }
+
+			ParenExprNode() : Node(nkParenExpr) {}
+			// read by ExpressionNode::parse with the expression around it
+			Node* parse() override { return nullptr; };
 		};
 
 		class TupleExprNode : public Node {
 		public:
-			vector<ExpressionNode*> values = vector<ExpressionNode*>();
+			static bool classof(const Node* n) { return n->kind == nkTupleExpr; }
 
-			Node* parse() override;
-			void  print() override;
+			TupleExprNode() : Node(nkTupleExpr) {}
+			ArenaList<ExpressionNode*> values;
+
+			// read by ExpressionNode::parse with the expression around it
+			Node* parse() override { return nullptr; };
 		};
 
 		class TupleTypeNode : public Node {
 		public:
-			vector<TypeNode*> types = vector<TypeNode*>();
+			static bool classof(const Node* n) { return n->kind == nkTupleType; }
+
+			TupleTypeNode() : Node(nkTupleType) {}
+			ArenaList<TypeNode*> types;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DeclVarNode : public Node {
@@ -255,12 +467,13 @@ namespace Lang {
 			IdentifierNode* name   = nullptr;
 			TypeNode*       type   = nullptr;
 
-			DeclVarNode(bool _inLoop = false) {
+			static bool classof(const Node* n) { return n->kind == nkDeclVar; }
+
+			DeclVarNode(bool _inLoop = false) : Node(nkDeclVar) {
 				inLoop = _inLoop;
 			}
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DeclConstNode : public Node {
@@ -270,12 +483,13 @@ namespace Lang {
 			IdentifierNode* name   = nullptr;
 			TypeNode*       type   = nullptr;
 
-			DeclConstNode(bool _inLoop = false) {
+			static bool classof(const Node* n) { return n->kind == nkDeclConst; }
+
+			DeclConstNode(bool _inLoop = false) : Node(nkDeclConst) {
 				inLoop = _inLoop;
 			}
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class AssignNode : public Node {
@@ -285,81 +499,99 @@ namespace Lang {
 			Node*           node  = nullptr;
 			ExpressionNode* value = nullptr;
 
-			AssignNode(BlockNode* _block) {
+			static bool classof(const Node* n) { return n->kind == nkAssign; }
+
+			AssignNode(BlockNode* _block) : Node(nkAssign) {
 				block = _block;
 			}
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class ReturnNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkReturn; }
+
+			ReturnNode() : Node(nkReturn) {}
 			ExpressionNode* value = nullptr;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class FieldNode : public Node {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkField; }
+
+			FieldNode() : Node(nkField) {}
 			bool            isConst      = false;
 			IdentifierNode* name         = nullptr;
 			TypeNode*       type         = nullptr;
 			ExpressionNode* defaultValue = nullptr;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class IfNode : public ScopeNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkIf; }
+
+			IfNode() : ScopeNode(nkIf) {}
 			ExpressionNode* condExpr  = nullptr;
 			BlockNode*      ifBlock   = nullptr;
 			Node*           elseBlock = nullptr;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class LoopNode : public ScopeNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkLoop; }
+
+			LoopNode() : ScopeNode(nkLoop) {}
 			Node* block = nullptr;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class BreakNode : public Node {
 		public:
-			BreakNode() {
-				token = new Token(Token::Kind::kKeyword, Token::Type::tBreak, "break", 0, 0);
+			static bool classof(const Node* n) { return n->kind == nkBreak; }
+
+			static Token Synthetic;
+
+			BreakNode() : Node(nkBreak) {
+				token = &Synthetic;
 			}
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class EachNode : public ScopeNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkEach; }
+
+			EachNode() : ScopeNode(nkEach) {}
 			Node*           each  = nullptr;
 			ExpressionNode* in    = nullptr;
 			BlockNode*      block = nullptr;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DefineNameNode : public Node {
 		public:
-			IdentifierNode*         name         = nullptr;
-			vector<IdentifierNode*> genericNames = vector<IdentifierNode*>();
+			static bool classof(const Node* n) { return n->kind == nkDefineName; }
+
+			DefineNameNode() : Node(nkDefineName) {}
+			IdentifierNode*            name         = nullptr;
+			ArenaList<IdentifierNode*> genericNames;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DefineFuncNode : public ScopeNode {
 		public:
+			static bool classof(const Node* n) { return n->kind == nkDefineFunc; }
+
 			enum Mode {
 				dfmNormal,
 				dfmInterface,
@@ -367,47 +599,52 @@ namespace Lang {
 				dfmValue,
 			};
 		private:
-			Mode               mode       = dfmNormal;
+			Mode                  mode       = dfmNormal;
 		public:
-			DefineNameNode*    name       = nullptr;
-			vector<FieldNode*> args       = vector<FieldNode*>();
-			TypeNode*          returnType = nullptr;
-			BlockNode*         block      = nullptr;
+			DefineNameNode*       name       = nullptr;
+			ArenaList<FieldNode*> args;
+			TypeNode*             returnType = nullptr;
+			BlockNode*            block      = nullptr;
 
-			DefineFuncNode(Mode _mode = dfmNormal) {
+			DefineFuncNode(Mode _mode = dfmNormal) : ScopeNode(nkDefineFunc) {
 				mode = _mode;
 			}
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DefineStructNode : public Node {
 		public:
-			DefineNameNode*    name   = nullptr;
-			vector<FieldNode*> fields = vector<FieldNode*>();
+			static bool classof(const Node* n) { return n->kind == nkDefineStruct; }
+
+			DefineStructNode() : Node(nkDefineStruct) {}
+			DefineNameNode*       name   = nullptr;
+			ArenaList<FieldNode*> fields;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DefineImplNode : public Node {
 		public:
-			DefineNameNode*         name  = nullptr;
-			DefineNameNode*         iface = nullptr;
-			vector<DefineFuncNode*> funcs = vector<DefineFuncNode*>();
+			static bool classof(const Node* n) { return n->kind == nkDefineImpl; }
+
+			DefineImplNode() : Node(nkDefineImpl) {}
+			DefineNameNode*            name  = nullptr;
+			DefineNameNode*            iface = nullptr;
+			ArenaList<DefineFuncNode*> funcs;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		class DefineInterfaceNode : public Node {
 		public:
-			DefineNameNode*         name  = nullptr;
-			vector<DefineFuncNode*> funcs = vector<DefineFuncNode*>();
+			static bool classof(const Node* n) { return n->kind == nkDefineInterface; }
+
+			DefineInterfaceNode() : Node(nkDefineInterface) {}
+			DefineNameNode*            name  = nullptr;
+			ArenaList<DefineFuncNode*> funcs;
 
 			Node* parse() override;
-			void  print() override;
 		};
 
 		
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "ast.h"
+
+namespace Lang {
+	// the children of a node, by the member holding them
+	enum TreeField : uint8_t {
+		tfLeft = 1, tfRight, tfFunc, tfArgs, tfNode, tfIndex, tfNodes, tfValues, tfTypes,
+		tfCondExpr, tfIfBlock, tfElseBlock, tfBlock, tfEach, tfIn, tfName, tfReturnType,
+		tfGenericTypes, tfGenericNames, tfType, tfValue, tfDefaultValue, tfFields, tfIface, tfFuncs,
+	};
+
+	// The one list of which members of each kind hold its children, and in
+	// what order; every walk over children, writeTree and FlatAST included,
+	// goes through it, so a new kind or member is added here only. one is
+	// called with each member holding a single child, set or not, as a
+	// reference to the typed pointer, and many with each vector of them; a
+	// kind has at most one vector. Expression, PrimaryExpr, ParenExpr and
+	// SubscriptIndex only drive parsing and never stay in a finished tree.
+	template <class One, class Many>
+	void forEachField(AST::Node* n, One&& one, Many&& many) {
+		typedef AST::Node N;
+		switch (n->kind) {
+		case N::nkLiteral:
+		case N::nkIdentifier:
+		case N::nkOperator:
+		case N::nkBreak:
+		case N::nkExpression:
+		case N::nkSubscriptIndex:
+		case N::nkPrimaryExpr:
+		case N::nkParenExpr:
+			return;
+		case N::nkBinaryOperator: {
+			auto b = cast<AST::BinaryOperatorNode>(n);
+			one(tfLeft, b->left);
+			one(tfRight, b->right);
+			return;
+		}
+		case N::nkFuncCall: {
+			auto b = cast<AST::FuncCallNode>(n);
+			one(tfFunc, b->left);
+			one(tfArgs, b->right);
+			return;
+		}
+		case N::nkSubscript: {
+			auto b = cast<AST::SubscriptNode>(n);
+			one(tfNode, b->left);
+			one(tfIndex, b->right);
+			return;
+		}
+		case N::nkUnaryOperator:
+			one(tfNode, cast<AST::UnaryOperatorNode>(n)->node);
+			return;
+		case N::nkBlock:
+			many(tfNodes, cast<AST::BlockNode>(n)->nodes);
+			return;
+		case N::nkIf: {
+			auto i = cast<AST::IfNode>(n);
+			one(tfCondExpr, i->condExpr);
+			one(tfIfBlock, i->ifBlock);
+			one(tfElseBlock, i->elseBlock);
+			return;
+		}
+		case N::nkLoop:
+			one(tfBlock, cast<AST::LoopNode>(n)->block);
+			return;
+		case N::nkEach: {
+			auto e = cast<AST::EachNode>(n);
+			one(tfEach, e->each);
+			one(tfIn, e->in);
+			one(tfBlock, e->block);
+			return;
+		}
+		case N::nkDefineFunc: {
+			auto d = cast<AST::DefineFuncNode>(n);
+			one(tfName, d->name);
+			many(tfArgs, d->args);
+			one(tfReturnType, d->returnType);
+			one(tfBlock, d->block);
+			return;
+		}
+		case N::nkTypeName: {
+			auto t = cast<AST::TypeNameNode>(n);
+			one(tfName, t->name);
+			many(tfGenericTypes, t->genericTypes);
+			return;
+		}
+		case N::nkType:
+			one(tfName, cast<AST::TypeNode>(n)->name);
+			return;
+		case N::nkFuncCallArgs:
+			many(tfNodes, cast<AST::FuncCallArgsNode>(n)->nodes);
+			return;
+		case N::nkTupleExpr:
+			many(tfValues, cast<AST::TupleExprNode>(n)->values);
+			return;
+		case N::nkTupleType:
+			many(tfTypes, cast<AST::TupleTypeNode>(n)->types);
+			return;
+		case N::nkDeclVar: {
+			auto d = cast<AST::DeclVarNode>(n);
+			one(tfName, d->name);
+			one(tfType, d->type);
+			return;
+		}
+		case N::nkDeclConst: {
+			auto d = cast<AST::DeclConstNode>(n);
+			one(tfName, d->name);
+			one(tfType, d->type);
+			return;
+		}
+		case N::nkAssign: {
+			auto a = cast<AST::AssignNode>(n);
+			one(tfNode, a->node);
+			one(tfValue, a->value);
+			return;
+		}
+		case N::nkReturn:
+			one(tfValue, cast<AST::ReturnNode>(n)->value);
+			return;
+		case N::nkField: {
+			auto d = cast<AST::FieldNode>(n);
+			one(tfName, d->name);
+			one(tfType, d->type);
+			one(tfDefaultValue, d->defaultValue);
+			return;
+		}
+		case N::nkDefineName: {
+			auto d = cast<AST::DefineNameNode>(n);
+			one(tfName, d->name);
+			many(tfGenericNames, d->genericNames);
+			return;
+		}
+		case N::nkDefineStruct: {
+			auto d = cast<AST::DefineStructNode>(n);
+			one(tfName, d->name);
+			many(tfFields, d->fields);
+			return;
+		}
+		case N::nkDefineImpl: {
+			auto d = cast<AST::DefineImplNode>(n);
+			one(tfName, d->name);
+			one(tfIface, d->iface);
+			many(tfFuncs, d->funcs);
+			return;
+		}
+		case N::nkDefineInterface: {
+			auto d = cast<AST::DefineInterfaceNode>(n);
+			one(tfName, d->name);
+			many(tfFuncs, d->funcs);
+			return;
+		}
+		}
+	}
+
+	// Calls f on each direct child of n that is set, in the order writeTree
+	// writes them.
+	template <class F>
+	void forEachChild(AST::Node* n, F&& f) {
+		forEachField(n, [&](TreeField, AST::Node* c) {
+			if (c != nullptr) f(c);
+		}, [&](TreeField, auto& list) {
+			for (auto c : list) {
+				if (c != nullptr) f(c);
+			}
+		});
+	}
+
+	// Dispatches on the node kind with one switch, no virtual call or RTTI.
+	// A pass derives as `class P : public NodeVisitor<P>` and defines the
+	// visitXxx it cares about; the rest fall through to the base class's
+	// handler (FuncCall to BinaryOperator to Operator, If to Scope, ...)
+	// and finally to visitNode. Nothing recurses on its own; a handler
+	// that wants the subtree calls visitChildren.
+	//
+	// visitChildren only queues the children: visitTree visits them after
+	// the handler returns, in order and before anything queued earlier,
+	// from a stack of its own, so a pass takes no stack whatever the depth
+	// of the tree. Expression chains are as deep as they are long.
+	template <class Derived, class R = void>
+	class NodeVisitor {
+	public:
+		// visits root and, as handlers ask for them, the nodes under it
+		void visitTree(AST::Node* root) {
+			auto base = queued.size();
+			if (root != nullptr) queued.push_back(root);
+			while (queued.size() > base) {
+				auto n = queued.back();
+				queued.pop_back();
+				auto asked = queued.size();
+				visit(n);
+				reverse(queued.begin() + asked, queued.end());
+			}
+		}
+
+		R visit(AST::Node* n) {
+			typedef AST::Node N;
+			switch (n->kind) {
+			case N::nkLiteral:         return self()->visitLiteral(cast<AST::LiteralNode>(n));
+			case N::nkIdentifier:      return self()->visitIdentifier(cast<AST::IdentifierNode>(n));
+			case N::nkOperator:        return self()->visitOperator(cast<AST::OperatorNode>(n));
+			case N::nkBinaryOperator:  return self()->visitBinaryOperator(cast<AST::BinaryOperatorNode>(n));
+			case N::nkFuncCall:        return self()->visitFuncCall(cast<AST::FuncCallNode>(n));
+			case N::nkSubscript:       return self()->visitSubscript(cast<AST::SubscriptNode>(n));
+			case N::nkUnaryOperator:   return self()->visitUnaryOperator(cast<AST::UnaryOperatorNode>(n));
+			case N::nkBlock:           return self()->visitBlock(cast<AST::BlockNode>(n));
+			case N::nkIf:              return self()->visitIf(cast<AST::IfNode>(n));
+			case N::nkLoop:            return self()->visitLoop(cast<AST::LoopNode>(n));
+			case N::nkEach:            return self()->visitEach(cast<AST::EachNode>(n));
+			case N::nkDefineFunc:      return self()->visitDefineFunc(cast<AST::DefineFuncNode>(n));
+			case N::nkTypeName:        return self()->visitTypeName(cast<AST::TypeNameNode>(n));
+			case N::nkType:            return self()->visitType(cast<AST::TypeNode>(n));
+			case N::nkExpression:      return self()->visitExpression(cast<AST::ExpressionNode>(n));
+			case N::nkFuncCallArgs:    return self()->visitFuncCallArgs(cast<AST::FuncCallArgsNode>(n));
+			case N::nkSubscriptIndex:  return self()->visitSubscriptIndex(cast<AST::SubscriptIndexNode>(n));
+			case N::nkPrimaryExpr:     return self()->visitPrimaryExpr(cast<AST::PrimaryExprNode>(n));
+			case N::nkParenExpr:       return self()->visitParenExpr(cast<AST::ParenExprNode>(n));
+			case N::nkTupleExpr:       return self()->visitTupleExpr(cast<AST::TupleExprNode>(n));
+			case N::nkTupleType:       return self()->visitTupleType(cast<AST::TupleTypeNode>(n));
+			case N::nkDeclVar:         return self()->visitDeclVar(cast<AST::DeclVarNode>(n));
+			case N::nkDeclConst:       return self()->visitDeclConst(cast<AST::DeclConstNode>(n));
+			case N::nkAssign:          return self()->visitAssign(cast<AST::AssignNode>(n));
+			case N::nkReturn:          return self()->visitReturn(cast<AST::ReturnNode>(n));
+			case N::nkField:           return self()->visitField(cast<AST::FieldNode>(n));
+			case N::nkBreak:           return self()->visitBreak(cast<AST::BreakNode>(n));
+			case N::nkDefineName:      return self()->visitDefineName(cast<AST::DefineNameNode>(n));
+			case N::nkDefineStruct:    return self()->visitDefineStruct(cast<AST::DefineStructNode>(n));
+			case N::nkDefineImpl:      return self()->visitDefineImpl(cast<AST::DefineImplNode>(n));
+			case N::nkDefineInterface: return self()->visitDefineInterface(cast<AST::DefineInterfaceNode>(n));
+			}
+			return R();
+		}
+
+		void visitChildren(AST::Node* n) {
+			forEachChild(n, [this](AST::Node* c) { queued.push_back(c); });
+		}
+
+		R visitNode(AST::Node*) { return R(); }
+
+		R visitLiteral(AST::LiteralNode* n)                 { return self()->visitNode(n); }
+		R visitIdentifier(AST::IdentifierNode* n)           { return self()->visitNode(n); }
+		R visitOperator(AST::OperatorNode* n)               { return self()->visitNode(n); }
+		R visitBinaryOperator(AST::BinaryOperatorNode* n)   { return self()->visitOperator(n); }
+		R visitFuncCall(AST::FuncCallNode* n)               { return self()->visitBinaryOperator(n); }
+		R visitSubscript(AST::SubscriptNode* n)             { return self()->visitBinaryOperator(n); }
+		R visitUnaryOperator(AST::UnaryOperatorNode* n)     { return self()->visitOperator(n); }
+		R visitScope(AST::ScopeNode* n)                     { return self()->visitNode(n); }
+		R visitBlock(AST::BlockNode* n)                     { return self()->visitScope(n); }
+		R visitIf(AST::IfNode* n)                           { return self()->visitScope(n); }
+		R visitLoop(AST::LoopNode* n)                       { return self()->visitScope(n); }
+		R visitEach(AST::EachNode* n)                       { return self()->visitScope(n); }
+		R visitDefineFunc(AST::DefineFuncNode* n)           { return self()->visitScope(n); }
+		R visitTypeName(AST::TypeNameNode* n)               { return self()->visitNode(n); }
+		R visitType(AST::TypeNode* n)                       { return self()->visitNode(n); }
+		R visitExpression(AST::ExpressionNode* n)           { return self()->visitNode(n); }
+		R visitFuncCallArgs(AST::FuncCallArgsNode* n)       { return self()->visitNode(n); }
+		R visitSubscriptIndex(AST::SubscriptIndexNode* n)   { return self()->visitNode(n); }
+		R visitPrimaryExpr(AST::PrimaryExprNode* n)         { return self()->visitNode(n); }
+		R visitParenExpr(AST::ParenExprNode* n)             { return self()->visitNode(n); }
+		R visitTupleExpr(AST::TupleExprNode* n)             { return self()->visitNode(n); }
+		R visitTupleType(AST::TupleTypeNode* n)             { return self()->visitNode(n); }
+		R visitDeclVar(AST::DeclVarNode* n)                 { return self()->visitNode(n); }
+		R visitDeclConst(AST::DeclConstNode* n)             { return self()->visitNode(n); }
+		R visitAssign(AST::AssignNode* n)                   { return self()->visitNode(n); }
+		R visitReturn(AST::ReturnNode* n)                   { return self()->visitNode(n); }
+		R visitField(AST::FieldNode* n)                     { return self()->visitNode(n); }
+		R visitBreak(AST::BreakNode* n)                     { return self()->visitNode(n); }
+		R visitDefineName(AST::DefineNameNode* n)           { return self()->visitNode(n); }
+		R visitDefineStruct(AST::DefineStructNode* n)       { return self()->visitNode(n); }
+		R visitDefineImpl(AST::DefineImplNode* n)           { return self()->visitNode(n); }
+		R visitDefineInterface(AST::DefineInterfaceNode* n) { return self()->visitNode(n); }
+
+	private:
+		// nodes asked for and not yet visited, the next one last
+		vector<AST::Node*> queued;
+
+		Derived* self() {
+			return static_cast<Derived*>(this);
+		}
+	};
+}
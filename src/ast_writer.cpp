@@ -0,0 +1,726 @@
+#include "ast_writer.h"
+#include <vector>
+
+namespace Lang {
+	namespace {
+		typedef AST::Node N;
+
+		const char* kindName(N::Kind k) {
+			switch (k) {
+			case N::nkLiteral:         return "Literal";
+			case N::nkIdentifier:      return "Identifier";
+			case N::nkOperator:        return "Operator";
+			case N::nkBinaryOperator:  return "BinaryOperator";
+			case N::nkFuncCall:        return "FuncCall";
+			case N::nkSubscript:       return "Subscript";
+			case N::nkUnaryOperator:   return "UnaryOperator";
+			case N::nkBlock:           return "Block";
+			case N::nkIf:              return "If";
+			case N::nkLoop:            return "Loop";
+			case N::nkEach:            return "Each";
+			case N::nkDefineFunc:      return "DefineFunc";
+			case N::nkTypeName:        return "TypeName";
+			case N::nkType:            return "Type";
+			case N::nkExpression:      return "Expression";
+			case N::nkFuncCallArgs:    return "FuncCallArgs";
+			case N::nkSubscriptIndex:  return "SubscriptIndex";
+			case N::nkPrimaryExpr:     return "PrimaryExpr";
+			case N::nkParenExpr:       return "ParenExpr";
+			case N::nkTupleExpr:       return "TupleExpr";
+			case N::nkTupleType:       return "TupleType";
+			case N::nkDeclVar:         return "DeclVar";
+			case N::nkDeclConst:       return "DeclConst";
+			case N::nkAssign:          return "Assign";
+			case N::nkReturn:          return "Return";
+			case N::nkField:           return "Field";
+			case N::nkBreak:           return "Break";
+			case N::nkDefineName:      return "DefineName";
+			case N::nkDefineStruct:    return "DefineStruct";
+			case N::nkDefineImpl:      return "DefineImpl";
+			case N::nkDefineInterface: return "DefineInterface";
+			}
+			return "";
+		}
+
+		const char* fieldName(TreeField f) {
+			switch (f) {
+			case tfLeft:         return "left";
+			case tfRight:        return "right";
+			case tfFunc:         return "func";
+			case tfArgs:         return "args";
+			case tfNode:         return "node";
+			case tfIndex:        return "index";
+			case tfNodes:        return "nodes";
+			case tfValues:       return "values";
+			case tfTypes:        return "types";
+			case tfCondExpr:     return "condExpr";
+			case tfIfBlock:      return "ifBlock";
+			case tfElseBlock:    return "elseBlock";
+			case tfBlock:        return "block";
+			case tfEach:         return "each";
+			case tfIn:           return "in";
+			case tfName:         return "name";
+			case tfReturnType:   return "returnType";
+			case tfGenericTypes: return "genericTypes";
+			case tfGenericNames: return "genericNames";
+			case tfType:         return "type";
+			case tfValue:        return "value";
+			case tfDefaultValue: return "defaultValue";
+			case tfFields:       return "fields";
+			case tfIface:        return "iface";
+			case tfFuncs:        return "funcs";
+			}
+			return "";
+		}
+
+		// the token a node was parsed from, nullptr for the ones it is
+		// given without a place in the source
+		Token* sourceToken(N* n) {
+			auto t = n->token;
+			if (t == &AST::FuncCallNode::Synthetic || t == &AST::SubscriptNode::Synthetic ||
+				t == &AST::BreakNode::Synthetic) return nullptr;
+			return t;
+		}
+
+		// kinds whose token says more than the kind does, an operator or a
+		// name; the rest hold a keyword or nothing
+		bool hasValue(N::Kind k) {
+			switch (k) {
+			case N::nkLiteral:
+			case N::nkIdentifier:
+			case N::nkOperator:
+			case N::nkBinaryOperator:
+			case N::nkUnaryOperator:
+			case N::nkAssign:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// One event of the walk. A node is replaced on the stack by the
+		// steps of its children and its own end, so no step recurses.
+		struct Step {
+			enum Op : uint8_t { sNode, sField, sEndField, sList, sEndList, sEndNode };
+
+			Op        op;
+			TreeField field;
+			uint32_t  count;
+			N*        node;
+		};
+
+		// the steps after a node, in the order forEachField gives them
+		class Children {
+		public:
+			vector<Step>& steps;
+
+			void one(TreeField f, N* c) {
+				if (c == nullptr) return;
+				steps.push_back({ Step::sField, f, 0, nullptr });
+				steps.push_back({ Step::sNode, f, 0, c });
+				steps.push_back({ Step::sEndField, f, 0, nullptr });
+			}
+
+			template <class T>
+			void many(TreeField f, const ArenaList<T*>& list) {
+				auto at = steps.size();
+				steps.push_back({ Step::sList, f, 0, nullptr });
+				uint32_t count = 0;
+				for (auto c : list) {
+					if (c == nullptr) continue;
+					steps.push_back({ Step::sNode, f, 0, c });
+					count++;
+				}
+				steps[at].count = count;
+				steps.push_back({ Step::sEndList, f, count, nullptr });
+			}
+
+			void of(N* n) {
+				forEachField(n, [this](TreeField f, N* c) {
+					one(f, c);
+				}, [this](TreeField f, auto& list) {
+					many(f, list);
+				});
+				steps.push_back({ Step::sEndNode, TreeField(0), 0, n });
+			}
+		};
+
+		// The one traversal every format shares, depth first with an
+		// explicit stack so deep trees cannot overflow the C++ one. W is
+		// one of the writers below; they are called directly, not through
+		// a virtual, as a pass is by NodeVisitor.
+		template <class W>
+		void walk(N* root, W& w) {
+			vector<Step> stack, steps;
+			Children children{ steps };
+			w.begin();
+			if (root != nullptr) stack.push_back({ Step::sNode, TreeField(0), 0, root });
+			while (!stack.empty()) {
+				auto s = stack.back();
+				stack.pop_back();
+				switch (s.op) {
+				case Step::sNode:
+					w.node(s.node);
+					steps.clear();
+					children.of(s.node);
+					stack.insert(stack.end(), steps.rbegin(), steps.rend());
+					break;
+				case Step::sField:    w.field(s.field); break;
+				case Step::sEndField: w.endField(s.field); break;
+				case Step::sList:     w.list(s.field, s.count); break;
+				case Step::sEndList:  w.endList(s.field, s.count); break;
+				case Step::sEndNode:  w.endNode(s.node); break;
+				}
+			}
+			w.end();
+		}
+
+		void number(Sink& out, uint64_t n) {
+			char s[24];
+			auto p = s + sizeof(s);
+			do {
+				*--p = char('0' + n % 10);
+				n /= 10;
+			} while (n > 0);
+			out.write(p, s + sizeof(s) - p);
+		}
+
+		// a quoted string as json has it, which S-expressions read too;
+		// the source is UTF-8, so only quotes, backslashes and control
+		// characters need escaping
+		void quoted(Sink& out, string_view s) {
+			static const char Hex[] = "0123456789abcdef";
+			out << "\"";
+			size_t from = 0;
+			for (size_t i = 0; i < s.size(); i++) {
+				auto c = (unsigned char)s[i];
+				if (c >= 0x20 && c != '"' && c != '\\') continue;
+				out.write(s.data() + from, i - from);
+				from = i + 1;
+				switch (c) {
+				case '"':  out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n"; break;
+				case '\r': out << "\\r"; break;
+				case '\t': out << "\\t"; break;
+				default: {
+					char e[] = { '\\', 'u', '0', '0', Hex[c >> 4], Hex[c & 15] };
+					out.write(e, sizeof(e));
+				}
+				}
+			}
+			out.write(s.data() + from, s.size() - from);
+			out << "\"";
+		}
+
+		// The page the html has always been: a node is a bordered box with
+		// its label over a table of its children, one cell each.
+		class HtmlWriter {
+		public:
+			Sink& out;
+			// for each field or list the walk is in, true for a list, whose
+			// items get a cell each
+			vector<bool> inList = {};
+
+			void begin() {
+				out << "<!DOCTYPE html><html><head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\" /><style type=\"text/css\">";
+				out << "td{ vertical-align: top; }";
+				out << "span{ display: block; text-align:center; }";
+				out << "div{ border-style: solid; border-width: 1px; text-align:center; padding:2px; }";
+				out << "</style></head><body><table><tr><td>";
+			}
+
+			void end() {
+				out << "</td></tr></table></body></html>";
+			}
+
+			void node(N* n) {
+				if (!inList.empty() && inList.back()) out << "<td>";
+				switch (n->kind) {
+				case N::nkLiteral:
+				case N::nkIdentifier:
+				case N::nkOperator:
+					out << "<div><span>" << n->token->value << "</span></div>";
+					break;
+				case N::nkBreak:
+					out << "<div><span>break</span></div>";
+					break;
+				case N::nkReturn:
+					out << "<div><span>Return</span>";
+					if (cast<AST::ReturnNode>(n)->value != nullptr) out << "<table><tr>";
+					break;
+				case N::nkType:
+					open("TYPE");
+					out << "<td>" << (cast<AST::TypeNode>(n)->isRef ? "&" : "") << "</td>";
+					break;
+				case N::nkField:
+					open("Field");
+					if (cast<AST::FieldNode>(n)->isConst) out << "<td>const</td>";
+					break;
+				case N::nkBinaryOperator:
+				case N::nkUnaryOperator:
+					open(n->token->value);
+					break;
+				default:
+					if (isTable(n->kind)) open(label(n->kind));
+					else out << "<div><span style=\"color:red\">" << n->typeName << "</span></div>";
+					break;
+				}
+			}
+
+			void endNode(N* n) {
+				switch (n->kind) {
+				case N::nkReturn:
+					if (cast<AST::ReturnNode>(n)->value != nullptr) out << "</tr></table>";
+					out << "</div>";
+					break;
+				case N::nkType: {
+					auto t = cast<AST::TypeNode>(n);
+					out << "<td>";
+					if (t->isArray) {
+						out << "[";
+						if (t->arrayLength > 0) out << t->arrayLength;
+						out << "]";
+					}
+					out << "</td>";
+					close();
+					break;
+				}
+				default:
+					if (isTable(n->kind)) close();
+					break;
+				}
+				if (!inList.empty() && inList.back()) out << "</td>";
+			}
+
+			void field(TreeField) {
+				out << "<td>";
+				inList.push_back(false);
+			}
+
+			void endField(TreeField) {
+				inList.pop_back();
+				out << "</td>";
+			}
+
+			// a definition's arguments, fields or methods share one cell
+			void list(TreeField f, uint32_t count) {
+				if (grouped(f) && count > 0) out << "<td><div><table><tr>";
+				inList.push_back(true);
+			}
+
+			void endList(TreeField f, uint32_t count) {
+				inList.pop_back();
+				if (grouped(f) && count > 0) out << "</tr></table></div></td>";
+			}
+
+		private:
+			static bool grouped(TreeField f) {
+				return f == tfArgs || f == tfFields || f == tfFuncs;
+			}
+
+			static bool isTable(N::Kind k) {
+				switch (k) {
+				case N::nkLiteral:
+				case N::nkIdentifier:
+				case N::nkOperator:
+				case N::nkBreak:
+				case N::nkExpression:
+				case N::nkSubscriptIndex:
+				case N::nkPrimaryExpr:
+				case N::nkParenExpr:
+					return false;
+				default:
+					return true;
+				}
+			}
+
+			static const char* label(N::Kind k) {
+				switch (k) {
+				case N::nkBlock:        return "BLOCK";
+				case N::nkFuncCall:     return "FnCall";
+				case N::nkFuncCallArgs: return "FnCallArgs";
+				case N::nkDeclVar:      return "var";
+				case N::nkDeclConst:    return "const";
+				case N::nkAssign:       return "=";
+				case N::nkIf:           return "if";
+				case N::nkLoop:         return "loop";
+				case N::nkEach:         return "each";
+				case N::nkTypeName:
+				case N::nkDefineName:   return "";
+				default:                return kindName(k);
+				}
+			}
+
+			void open(string_view label) {
+				out << "<div><span>" << label << "</span><table><tr>";
+			}
+
+			void close() {
+				out << "</tr></table></div>";
+			}
+		};
+
+		// what json and S-expressions both say about a node besides its
+		// kind and children
+		template <class Attr>
+		void attributes(N* n, Attr&& attr) {
+			if (n->kind == N::nkType) {
+				auto t = cast<AST::TypeNode>(n);
+				if (t->isRef) attr("ref", -1);
+				if (t->isArray) attr("array", -1);
+				if (t->arrayLength > 0) attr("length", t->arrayLength);
+			} else if (n->kind == N::nkField) {
+				if (cast<AST::FieldNode>(n)->isConst) attr("const", -1);
+			}
+		}
+
+		// One object per node on a single line; fields that are not set
+		// are left out and lists are always there. The token's text is
+		// under "text", which no field is called, as Assign has a value.
+		class JsonWriter {
+		public:
+			Sink& out;
+			// per field or list: 'f' a field, 'l' a list before its first
+			// item, 'n' one after it
+			vector<char> context = {};
+
+			void begin() {}
+
+			void end() {
+				out << "\n";
+			}
+
+			void node(N* n) {
+				if (!context.empty()) {
+					if (context.back() == 'n') out << ",";
+					else if (context.back() == 'l') context.back() = 'n';
+				}
+				out << "{\"kind\":\"" << kindName(n->kind) << "\"";
+				auto t = sourceToken(n);
+				if (t != nullptr) {
+					if (hasValue(n->kind)) {
+						out << ",\"text\":";
+						quoted(out, t->value);
+					}
+					out << ",\"offset\":";
+					number(out, t->offset);
+				}
+				attributes(n, [&](const char* name, int value) {
+					out << ",\"" << name << "\":";
+					if (value < 0) out << "true";
+					else number(out, value);
+				});
+			}
+
+			void endNode(N*) {
+				out << "}";
+			}
+
+			void field(TreeField f) {
+				out << ",\"" << fieldName(f) << "\":";
+				context.push_back('f');
+			}
+
+			void endField(TreeField) {
+				context.pop_back();
+			}
+
+			void list(TreeField f, uint32_t) {
+				out << ",\"" << fieldName(f) << "\":[";
+				context.push_back('l');
+			}
+
+			void endList(TreeField, uint32_t) {
+				context.pop_back();
+				out << "]";
+			}
+		};
+
+		// (Kind "value" :offset 12 :field (...) :list ((...) (...)))
+		class SexprWriter {
+		public:
+			Sink& out;
+			// as for json
+			vector<char> context = {};
+
+			void begin() {}
+
+			void end() {
+				out << "\n";
+			}
+
+			void node(N* n) {
+				if (!context.empty()) {
+					if (context.back() == 'n') out << " ";
+					else if (context.back() == 'l') context.back() = 'n';
+				}
+				out << "(" << kindName(n->kind);
+				auto t = sourceToken(n);
+				if (t != nullptr) {
+					if (hasValue(n->kind)) {
+						out << " ";
+						quoted(out, t->value);
+					}
+					out << " :offset ";
+					number(out, t->offset);
+				}
+				attributes(n, [&](const char* name, int value) {
+					out << " :" << name;
+					if (value >= 0) {
+						out << " ";
+						number(out, value);
+					}
+				});
+			}
+
+			void endNode(N*) {
+				out << ")";
+			}
+
+			void field(TreeField f) {
+				out << " :" << fieldName(f) << " ";
+				context.push_back('f');
+			}
+
+			void endField(TreeField) {
+				context.pop_back();
+			}
+
+			void list(TreeField f, uint32_t) {
+				out << " :" << fieldName(f) << " (";
+				context.push_back('l');
+			}
+
+			void endList(TreeField, uint32_t) {
+				context.pop_back();
+				out << ")";
+			}
+		};
+
+		// the layout is in ast_writer.h
+		class BinaryWriter {
+		public:
+			static constexpr uint8_t  Version = 1;
+			static constexpr uint32_t None    = ~0u;
+
+			Sink&    out;
+			unsigned lastOffset = 0;
+			// The number of each text written so far, by the order they
+			// first came: names by symbol and operators and short literals
+			// by their bytes, so none needs hashing.
+			vector<uint32_t> symbols    = {};
+			vector<uint32_t> shortTexts = {};
+			uint32_t         texts = 0;
+
+			void begin() {
+				out.write("XSAB", 4);
+				byte(Version);
+			}
+
+			void end() {}
+
+			void node(N* n) {
+				uint8_t flags = 0;
+				int length = 0;
+				if (n->kind == N::nkType) {
+					auto t = cast<AST::TypeNode>(n);
+					flags = (t->isRef ? 1 : 0) | (t->isArray ? 2 : 0);
+					length = t->arrayLength;
+				} else if (n->kind == N::nkField) {
+					flags = cast<AST::FieldNode>(n)->isConst ? 4 : 0;
+				}
+				auto t = sourceToken(n);
+				byte(n->kind | (t != nullptr ? 0x80 : 0) | (flags != 0 ? 0x40 : 0));
+				if (flags != 0) {
+					byte(flags);
+					if (flags & 2) varint(length);
+				}
+				if (t != nullptr) {
+					if (hasValue(n->kind)) text(t);
+					// zigzag, as the delta goes back at the end of a subtree
+					int64_t delta = (int64_t)t->offset - lastOffset;
+					varint(delta >= 0 ? (uint64_t)delta << 1 : ((uint64_t)-delta << 1) - 1);
+					lastOffset = t->offset;
+				}
+			}
+
+			void endNode(N* n) {
+				if (!isLeaf(n->kind)) byte(0);
+			}
+
+			void field(TreeField f) {
+				byte(f);
+			}
+
+			void endField(TreeField) {}
+
+			void list(TreeField f, uint32_t count) {
+				byte(0x80 | f);
+				varint(count);
+			}
+
+			void endList(TreeField, uint32_t) {}
+
+		private:
+			static bool isLeaf(N::Kind k) {
+				return k == N::nkLiteral || k == N::nkIdentifier || k == N::nkOperator || k == N::nkBreak;
+			}
+
+			void byte(uint8_t b) {
+				out.write((const char*)&b, 1);
+			}
+
+			// Names and operators repeat, so each is written once and then
+			// referred to by its number. Longer literals are mostly unique
+			// and spelled out every time; looking them up cost more time
+			// than it saved bytes.
+			void text(Token* t) {
+				// every text spelled out takes a number, remembered or not
+				uint32_t  unnamed = None;
+				uint32_t* number;
+				auto& s = t->value;
+				if (t->symbol != 0) {
+					if (t->symbol >= symbols.size()) symbols.resize(t->symbol + 1, None);
+					number = &symbols[t->symbol];
+				} else if (s.size() == 1 || s.size() == 2) {
+					if (shortTexts.empty()) shortTexts.resize(1 << 17, None);
+					auto c0 = (uint8_t)s[0], c1 = (uint8_t)s[s.size() - 1];
+					number = &shortTexts[(s.size() - 1) << 16 | c1 << 8 | c0];
+				} else {
+					number = &unnamed;
+				}
+				if (*number != None) {
+					varint((uint64_t)*number << 1 | 1);
+					return;
+				}
+				*number = texts++;
+				varint((uint64_t)s.size() << 1);
+				out << s;
+			}
+
+			void varint(uint64_t v) {
+				char s[10];
+				size_t n = 0;
+				while (v >= 0x80) {
+					s[n++] = char(v | 0x80);
+					v >>= 7;
+				}
+				s[n++] = char(v);
+				out.write(s, n);
+			}
+		};
+
+		// Calls f with the writer of format, as a W for walk.
+		template <class F>
+		void withWriter(Sink& out, TreeFormat format, F&& f) {
+			switch (format) {
+			case TreeFormat::Html: {
+				HtmlWriter w{ out };
+				f(w);
+				break;
+			}
+			case TreeFormat::Json: {
+				JsonWriter w{ out };
+				f(w);
+				break;
+			}
+			case TreeFormat::Sexpr: {
+				SexprWriter w{ out };
+				f(w);
+				break;
+			}
+			case TreeFormat::Binary: {
+				BinaryWriter w{ out };
+				f(w);
+				break;
+			}
+			}
+		}
+
+		// Passes the walk on to W, keeping the nodes whose output holds
+		// byte offset, those begun at or before it and not yet ended there,
+		// and the tokens written last before it and first after it.
+		template <class W>
+		class Locator {
+		public:
+			W&         w;
+			Sink&      out;
+			size_t     offset;
+			vector<N*> open   = {};
+			Token*     before = nullptr;
+			Token*     after  = nullptr;
+
+			void begin() { w.begin(); }
+			void end()   { w.end(); }
+
+			void node(N* n) {
+				auto t = sourceToken(n);
+				if (out.size() <= offset) {
+					open.push_back(n);
+					if (t != nullptr) before = t;
+				} else if (after == nullptr) {
+					after = t;
+				}
+				w.node(n);
+			}
+
+			void endNode(N* n) {
+				w.endNode(n);
+				if (out.size() <= offset && !open.empty() && open.back() == n) open.pop_back();
+			}
+
+			void field(TreeField f)                   { w.field(f); }
+			void endField(TreeField f)                { w.endField(f); }
+			void list(TreeField f, uint32_t count)    { w.list(f, count); }
+			void endList(TreeField f, uint32_t count) { w.endList(f, count); }
+		};
+	}
+
+	bool parseTreeFormat(string_view name, TreeFormat& format) {
+		if (name == "html") format = TreeFormat::Html;
+		else if (name == "json") format = TreeFormat::Json;
+		else if (name == "sexpr") format = TreeFormat::Sexpr;
+		else if (name == "bin") format = TreeFormat::Binary;
+		else return false;
+		return true;
+	}
+
+	const char* treeFormatExtension(TreeFormat format) {
+		switch (format) {
+		case TreeFormat::Html:   return ".html";
+		case TreeFormat::Json:   return ".json";
+		case TreeFormat::Sexpr:  return ".sexpr";
+		case TreeFormat::Binary: return ".xsab";
+		}
+		return "";
+	}
+
+	bool isBinaryTreeFormat(TreeFormat format) {
+		return format == TreeFormat::Binary;
+	}
+
+	void writeTree(Sink& out, AST::Node* root, TreeFormat format) {
+		withWriter(out, format, [&](auto& w) {
+			walk(root, w);
+		});
+	}
+
+	TreeSpot findInOutput(AST::Node* root, TreeFormat format, size_t offset) {
+		Sink out;
+		out.discard();
+		TreeSpot spot;
+		withWriter(out, format, [&](auto& w) {
+			Locator<typename remove_reference<decltype(w)>::type> l{ w, out, offset };
+			walk(root, l);
+			if (!l.open.empty()) spot.node = l.open.back();
+			spot.token = spot.node != nullptr ? sourceToken(spot.node) : nullptr;
+			if (spot.token == nullptr) spot.token = l.before != nullptr ? l.before : l.after;
+		});
+		return spot;
+	}
+
+	const char* treeKindName(AST::Node::Kind kind) {
+		return kindName(kind);
+	}
+}
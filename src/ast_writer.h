@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string_view>
+#include "ast.h"
+#include "ast_visit.h"
+#include "sink.h"
+
+namespace Lang {
+	// How a tree is written out. All of them come from one walk over the
+	// tree (writeTree), each format only deciding how a node, a named field
+	// and a list of children look, and all of them stream into the sink.
+	//
+	// html   the nested tables shown in a browser, as always written
+	// json   {"kind":"If","offset":12,"condExpr":{...},"ifBlock":{...}},
+	//        fields named as the members of the node class, and an
+	//        operator's or a name's text under "text"
+	// sexpr  (If :offset 12 :condExpr (...) :ifBlock (...))
+	// bin    compact and length-prefixed, for tools reading many trees:
+	//
+	//          file  = "XSAB" version:u8 node?
+	//          node  = kind:u8 [flags:u8 [length:varint]] [token] [child* 0:u8]
+	//          token = [text] offset:varint
+	//          text  = (size << 1):varint bytes | (number << 1 | 1):varint
+	//          child = field:u8 node
+	//                | (0x80 | field):u8 count:varint node*
+	//
+	//        kind is AST::Node::Kind, with 0x80 set when a token follows and
+	//        0x40 when flags do: 1 ref, 2 array, whose length follows, and
+	//        4 const. Literal, Identifier, Operator, BinaryOperator,
+	//        UnaryOperator and Assign carry the token's text; other tokens
+	//        are keywords and only give the offset. Each text spelled out
+	//        takes the next number from 0, and a name or a text of one or
+	//        two bytes is given by that number when it comes again. The
+	//        offset is the difference from the token before, zigzag
+	//        encoded, so mostly one byte. field is a TreeField, from
+	//        ast_visit.h, a list when 0x80 is set. Literal, Identifier,
+	//        Operator and Break have no children and so no 0 after them.
+	//        Varints are LEB128.
+	enum class TreeFormat { Html, Json, Sexpr, Binary };
+
+	// the format named on the command line, false when there is none
+	bool        parseTreeFormat(string_view name, TreeFormat& format);
+	// the extension of files in the format, with the dot
+	const char* treeFormatExtension(TreeFormat format);
+	// whether the format is bytes rather than text
+	bool        isBinaryTreeFormat(TreeFormat format);
+
+	// writes root and all below it, with the html page or the binary
+	// header around it; a null root writes an empty document
+	void        writeTree(Sink& out, AST::Node* root, TreeFormat format);
+	// Where byte offset of root's output in the format came from, to tell
+	// where output that differs from a saved one went wrong: the innermost
+	// node whose output holds it, and that node's token or, for nodes
+	// without one, the nearest token written before the offset (after it
+	// when there is none before).
+	struct TreeSpot {
+		AST::Node* node  = nullptr;
+		Token*     token = nullptr;
+	};
+	TreeSpot    findInOutput(AST::Node* root, TreeFormat format, size_t offset);
+	// the name json and S-expressions give a kind
+	const char* treeKindName(AST::Node::Kind kind);
+}
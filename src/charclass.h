@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include "simd.h"
+
+namespace Lang {
+	// Byte classes used by Lexer::parse to pick a scanner for the next token.
+	enum CharClass : unsigned char {
+		ccOther,
+		ccSpace,    // ' ' \t \r \n
+		ccIdent,    // letters, _ and UTF-8 bytes
+		ccDigit,    // 0-9
+		ccQuote,    // "
+		ccSlash,    // / // /* /=
+		ccStar,     // * *=
+		ccMinus,    // - -> -=
+		ccAmp,      // & &&
+		ccPipe,     // ||
+		ccOperator, // + % ! = > < with optional =
+		ccPunct,    // ( ) [ ] { } : , ; .
+	};
+
+	struct CharTable {
+		unsigned char cls[256]   = {};
+		bool          ident[256] = {};
+	};
+
+	constexpr CharTable makeCharTable() {
+		CharTable t;
+		for (int c = 0; c < 256; c++) {
+			bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+			bool digit = c >= '0' && c <= '9';
+			// 0xFF never appears in UTF-8 and was the lexer's end-of-line marker
+			bool utf8 = c >= 0x80 && c != 0xFF;
+			t.ident[c] = alpha || digit || utf8;
+			if (alpha || utf8) t.cls[c] = ccIdent;
+			if (digit) t.cls[c] = ccDigit;
+		}
+		t.cls[(unsigned char)' ']  = ccSpace;
+		t.cls[(unsigned char)'\t'] = ccSpace;
+		t.cls[(unsigned char)'\r'] = ccSpace;
+		t.cls[(unsigned char)'\n'] = ccSpace;
+		t.cls[(unsigned char)'"']  = ccQuote;
+		t.cls[(unsigned char)'/']  = ccSlash;
+		t.cls[(unsigned char)'*']  = ccStar;
+		t.cls[(unsigned char)'-']  = ccMinus;
+		t.cls[(unsigned char)'&']  = ccAmp;
+		t.cls[(unsigned char)'|']  = ccPipe;
+		for (auto c : "+%!=><") if (c) t.cls[(unsigned char)c] = ccOperator;
+		for (auto c : "()[]{}:,;.") if (c) t.cls[(unsigned char)c] = ccPunct;
+		return t;
+	}
+
+	constexpr CharTable Chars = makeCharTable();
+
+#ifdef LANG_SSE2
+	inline int spaceMask(__m128i v) {
+		auto m = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+		return _mm_movemask_epi8(m);
+	}
+
+	inline __m128i digitBytes(__m128i v) {
+		return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+	}
+
+	inline int digitMask(__m128i v) {
+		return _mm_movemask_epi8(digitBytes(v));
+	}
+
+	inline int identMask(__m128i v) {
+		// or-ing 0x20 folds A-Z onto a-z without pulling in other ASCII bytes
+		auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+		auto under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+		auto utf8  = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xFF)), _mm_cmplt_epi8(v, _mm_setzero_si128()));
+		return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, under), _mm_or_si128(utf8, digitBytes(v))));
+	}
+#endif
+
+#ifdef LANG_AVX2
+	inline unsigned spaceMask(__m256i v) {
+		auto m = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+		return (unsigned)_mm256_movemask_epi8(m);
+	}
+
+	inline __m256i digitBytes(__m256i v) {
+		return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+	}
+
+	inline unsigned digitMask(__m256i v) {
+		return (unsigned)_mm256_movemask_epi8(digitBytes(v));
+	}
+
+	inline unsigned identMask(__m256i v) {
+		auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+		auto under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+		auto utf8  = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xFF)), _mm256_cmpgt_epi8(_mm256_setzero_si256(), v));
+		return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, under), _mm256_or_si256(utf8, digitBytes(v))));
+	}
+#endif
+
+	// Length of the run at p for which MASK/TABLE hold, 32 or 16 bytes per
+	// step where available. The scalar loop finishes the tail.
+#if defined(LANG_AVX2)
+#define LANG_SCAN_RUN(MASK, TABLE)                                              \
+		auto s = p;                                                             \
+		if (simd) {                                                             \
+			for (; end - s >= 32; s += 32) {                                    \
+				auto m = ~MASK(_mm256_loadu_si256((const __m256i*)s));          \
+				if (m) return (size_t)(s - p) + countTrailingZeros(m);          \
+			}                                                                   \
+			for (; end - s >= 16; s += 16) {                                    \
+				auto m = ~(unsigned)MASK(_mm_loadu_si128((const __m128i*)s)) & 0xFFFF; \
+				if (m) return (size_t)(s - p) + countTrailingZeros(m);          \
+			}                                                                   \
+		}                                                                       \
+		while (s < end && TABLE) s++;                                           \
+		return (size_t)(s - p);
+#elif defined(LANG_SSE2)
+#define LANG_SCAN_RUN(MASK, TABLE)                                              \
+		auto s = p;                                                             \
+		if (simd) {                                                             \
+			for (; end - s >= 16; s += 16) {                                    \
+				auto m = ~(unsigned)MASK(_mm_loadu_si128((const __m128i*)s)) & 0xFFFF; \
+				if (m) return (size_t)(s - p) + countTrailingZeros(m);          \
+			}                                                                   \
+		}                                                                       \
+		while (s < end && TABLE) s++;                                           \
+		return (size_t)(s - p);
+#else
+#define LANG_SCAN_RUN(MASK, TABLE)                                              \
+		(void)simd;                                                             \
+		auto s = p;                                                             \
+		while (s < end && TABLE) s++;                                           \
+		return (size_t)(s - p);
+#endif
+
+	inline size_t spaceRun(const char* p, const char* end, bool simd) {
+		LANG_SCAN_RUN(spaceMask, Chars.cls[(unsigned char)*s] == ccSpace)
+	}
+
+	inline size_t identRun(const char* p, const char* end, bool simd) {
+		LANG_SCAN_RUN(identMask, Chars.ident[(unsigned char)*s])
+	}
+
+	inline size_t digitRun(const char* p, const char* end, bool simd) {
+		LANG_SCAN_RUN(digitMask, Chars.cls[(unsigned char)*s] == ccDigit)
+	}
+
+#undef LANG_SCAN_RUN
+
+	// First position in [p, end) holding a or b, or end.
+	inline const char* findEither(const char* p, const char* end, char a, char b, bool simd) {
+#ifdef LANG_SSE2
+		if (simd) {
+			auto va = _mm_set1_epi8(a);
+			auto vb = _mm_set1_epi8(b);
+			for (; end - p >= 16; p += 16) {
+				auto v = _mm_loadu_si128((const __m128i*)p);
+				auto m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+				if (m) return p + countTrailingZeros(m);
+			}
+		}
+#else
+		(void)simd;
+#endif
+		while (p < end && *p != a && *p != b) p++;
+		return p;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+namespace Lang {
+	// A problem found in a source. row and col are 1-based, 0 when the
+	// position is unknown.
+	struct Diagnostic {
+		int    row = 0;
+		int    col = 0;
+		string message;
+	};
+
+	// Collects the diagnostics of one file in the order they are found, so
+	// lexing and parsing can go on past an error instead of unwinding.
+	class Diagnostics {
+	public:
+		void report(int row, int col, string message) {
+			list.push_back({ row, col, move(message) });
+		}
+
+		bool   empty() const { return list.empty(); }
+		size_t size()  const { return list.size(); }
+
+		const vector<Diagnostic>& all() const {
+			return list;
+		}
+
+		// one "[row,col] message" line per diagnostic, in source order; a
+		// streaming parse interleaves lexer and parser reports
+		string str() const {
+			auto sorted = list;
+			stable_sort(sorted.begin(), sorted.end(), [](const Diagnostic& a, const Diagnostic& b) {
+				return a.row != b.row ? a.row < b.row : a.col < b.col;
+			});
+			stringstream ss;
+			for (size_t i = 0; i < sorted.size(); i++) {
+				if (i > 0) ss << "\n";
+				ss << "[" << sorted[i].row << "," << sorted[i].col << "] " << sorted[i].message;
+			}
+			return ss.str();
+		}
+
+	private:
+		vector<Diagnostic> list;
+	};
+}
@@ -0,0 +1,187 @@
+#include "document.h"
+#include <algorithm>
+#include <iterator>
+
+namespace Lang {
+	Document::Chunk::Chunk(string text) {
+		source.assign(move(text));
+		lexer.reset(new Lexer(&source));
+
+		auto& lines = source.lineStarts();
+		auto s = this->text();
+		breaks = lines.empty() ? 0 : (int)lines.size() - 1;
+		tail = s.size() - (lines.empty() ? 0 : lines.back());
+		// a break at the very end starts no line in lineStarts
+		if (!s.empty() && (s.back() == '\n' || s.back() == '\r')) {
+			breaks++;
+			tail = 0;
+		}
+	}
+
+	void Document::Chunk::parse() {
+		ast.reset(new AST(lexer.get()));
+		root = ast->parse();
+	}
+
+	Document::Document(string text) {
+		rebuild(0, 0, move(text));
+	}
+
+	void Document::edit(size_t offset, size_t removed, string_view inserted) {
+		auto total = size();
+		if (offset > total) offset = total;
+		if (removed > total - offset) removed = total - offset;
+
+		// the last byte of a chunk touches the first token of the next, so
+		// an edit on a boundary takes in both sides
+		auto first = find(offset);
+		if (first > 0 && chunks[first]->start == offset) first--;
+		auto last = find(offset + removed) + 1;
+
+		string text;
+		for (auto i = first; i < last; i++) text.append(chunks[i]->text());
+		text.replace(offset - chunks[first]->start, removed, inserted.data(), inserted.size());
+		rebuild(first, last, move(text));
+	}
+
+	// Replaces chunks [first, last) with text, taking in neighbours until the
+	// text starts and ends where chunks may, then cuts it up again. A piece
+	// whose assignment found nothing to take would have taken the last
+	// statement before it, so it stays joined to what precedes it.
+	void Document::rebuild(size_t first, size_t last, string text) {
+		// document offsets where a cut was undone
+		vector<size_t> joined;
+		vector<unique_ptr<Chunk>> pieces;
+		// neighbours to take in next; doubled each time, so an edit that
+		// opens a comment to the end relexes the rest a few times, not once
+		// per chunk
+		size_t before = 1, after = 1;
+		while (true) {
+			unique_ptr<Chunk> whole(new Chunk(text));
+			auto cuts = AST::split(whole->lexer.get());
+			if (first > 0 && !cuts.head) {
+				auto from = first - min(before, first);
+				string head;
+				for (auto i = from; i < first; i++) head.append(chunks[i]->text());
+				text.insert(0, head);
+				first = from;
+				before *= 2;
+				continue;
+			}
+			if (last < chunks.size() && !cuts.clean) {
+				for (auto n = min(after, chunks.size() - last); n > 0; n--) {
+					text.append(chunks[last]->text());
+					last++;
+				}
+				after *= 2;
+				continue;
+			}
+
+			auto base = first < chunks.size() ? chunks[first]->start : 0;
+			vector<size_t> starts{ 0 };
+			for (auto i : cuts.starts) {
+				size_t to = whole->lexer->at(i)->offset;
+				if (std::find(joined.begin(), joined.end(), base + to) == joined.end()) starts.push_back(to);
+			}
+			pieces.clear();
+			if (starts.size() == 1) {
+				pieces.push_back(move(whole));
+			} else {
+				for (size_t i = 0; i < starts.size(); i++) {
+					auto to = i + 1 < starts.size() ? starts[i + 1] : text.size();
+					pieces.emplace_back(new Chunk(text.substr(starts[i], to - starts[i])));
+				}
+			}
+
+			bool again = false;
+			for (size_t i = 0; i < pieces.size(); i++) {
+				pieces[i]->parse();
+				if (!pieces[i]->ast->orphaned()) continue;
+				if (i > 0) {
+					joined.push_back(base + starts[i]);
+					again = true;
+				} else if (first > 0) {
+					first--;
+					text.insert(0, chunks[first]->text());
+					again = true;
+				}
+			}
+			if (!again) break;
+		}
+		lastParsed = pieces.size();
+
+		chunks.erase(chunks.begin() + first, chunks.begin() + last);
+		chunks.insert(chunks.begin() + first, make_move_iterator(pieces.begin()), make_move_iterator(pieces.end()));
+		place();
+	}
+
+	void Document::place() {
+		size_t start = 0;
+		int row = 1, col = 1;
+		for (auto& c : chunks) {
+			c->start = start;
+			c->row = row;
+			c->col = col;
+			start += c->source.size();
+			if (c->breaks > 0) {
+				row += c->breaks;
+				col = (int)c->tail + 1;
+			} else {
+				col += (int)c->tail;
+			}
+		}
+	}
+
+	// the chunk holding offset
+	size_t Document::find(size_t offset) const {
+		auto it = upper_bound(chunks.begin(), chunks.end(), offset, [](size_t o, const unique_ptr<Chunk>& c) {
+			return o < c->start;
+		});
+		return it == chunks.begin() ? 0 : (size_t)(it - chunks.begin()) - 1;
+	}
+
+	string Document::text() const {
+		string s;
+		s.reserve(size());
+		for (auto& c : chunks) s.append(c->text());
+		return s;
+	}
+
+	size_t Document::size() const {
+		auto& c = chunks.back();
+		return c->start + c->source.size();
+	}
+
+	vector<AST::Node*> Document::nodes() {
+		vector<AST::Node*> list;
+		for (auto& c : chunks) {
+			if (c->based != c->start) {
+				auto delta = (unsigned)(c->start - c->based);
+				for (int i = 0, n = c->lexer->count(); i < n; i++) c->lexer->at(i)->offset += delta;
+				c->based = c->start;
+			}
+			auto& n = cast<AST::BlockNode>(c->root)->nodes;
+			list.insert(list.end(), n.begin(), n.end());
+		}
+		return list;
+	}
+
+	void Document::position(size_t offset, int* row, int* col) const {
+		auto& c = chunks[find(offset)];
+		c->source.position(offset - c->start, row, col);
+		if (*row == 1) *col += c->col - 1;
+		*row += c->row - 1;
+	}
+
+	Diagnostics Document::diagnostics() const {
+		Diagnostics d;
+		for (auto& c : chunks) {
+			for (auto& e : c->lexer->diagnostics().all()) {
+				if (e.row == 0) d.report(0, 0, e.message);
+				else if (e.row == 1) d.report(c->row, c->col + e.col - 1, e.message);
+				else d.report(c->row + e.row - 1, e.col, e.message);
+			}
+		}
+		return d;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+
+using namespace std;
+
+namespace Lang {
+	// A source kept open for editing. It is split into chunks that start at
+	// top-level declarations, and each chunk has its own text, tokens and
+	// AST. An edit relexes and reparses only the chunks it touches, plus
+	// neighbours when the edit changes where a chunk may begin or end.
+	// Every other subtree is kept as it is. nodes() and diagnostics() are
+	// what a full parse of text() would give, token offsets included:
+	// nodes() moves the tokens of each chunk an edit shifted to its place
+	// in the document, so edits themselves never touch them.
+	class Document {
+	public:
+		Document(string text);
+
+		// replaces `removed` bytes at offset with inserted
+		void edit(size_t offset, size_t removed, string_view inserted);
+
+		string text() const;
+		size_t size() const;
+
+		// top-level statements of the whole source, in order, their tokens
+		// at offsets in text(). Not const, as it writes those offsets: a
+		// reader of the tokens must not run alongside it.
+		vector<AST::Node*> nodes();
+		// positions are in the whole source
+		Diagnostics diagnostics() const;
+		// the 1-based row and column of an offset in text(), as a token's
+		void position(size_t offset, int* row, int* col) const;
+
+		size_t chunkCount() const {
+			return chunks.size();
+		}
+
+		// chunks parsed by the last edit
+		size_t reparsed() const {
+			return lastParsed;
+		}
+
+	private:
+		struct Chunk {
+			Source            source;
+			unique_ptr<Lexer> lexer;
+			unique_ptr<AST>   ast;
+			AST::Node*        root   = nullptr;
+			// position of the chunk's first byte in the document, and the
+			// one its token offsets count from
+			size_t            start  = 0;
+			size_t            based  = 0;
+			int               row    = 1;
+			int               col    = 1;
+			// line breaks in the chunk, and bytes after the last one
+			int               breaks = 0;
+			size_t            tail   = 0;
+
+			Chunk(string text);
+			void parse();
+
+			string_view text() const {
+				return string_view(source.data(), source.size());
+			}
+		};
+
+		vector<unique_ptr<Chunk>> chunks;
+		size_t                    lastParsed = 0;
+
+		size_t find(size_t offset) const;
+		void   rebuild(size_t first, size_t last, string text);
+		void   place();
+	};
+}
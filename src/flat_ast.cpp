@@ -0,0 +1,390 @@
+#include "flat_ast.h"
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include "ast_visit.h"
+
+namespace Lang {
+	namespace {
+		struct Header {
+			char     magic[4];
+			uint32_t version;
+			// 0x01020304 as written, so a file from a machine of the other
+			// byte order is refused rather than misread
+			uint32_t order;
+			uint32_t nodes;
+			uint32_t slots;
+			uint32_t tokens;
+			uint32_t text;
+			uint32_t unused;
+			uint64_t check;
+		};
+
+		const char     Magic[4] = { 'X', 'S', 'A', 'F' };
+		const uint32_t Order    = 0x01020304;
+
+		// the class name NODE_P gives each kind, which the html shows for
+		// kinds it has no box for
+		const char* typeName(AST::Node::Kind k) {
+			typedef AST::Node N;
+			switch (k) {
+			case N::nkLiteral:         return "LiteralNode";
+			case N::nkIdentifier:      return "IdentifierNode";
+			case N::nkOperator:        return "OperatorNode";
+			case N::nkBinaryOperator:  return "BinaryOperatorNode";
+			case N::nkFuncCall:        return "FuncCallNode";
+			case N::nkSubscript:       return "SubscriptNode";
+			case N::nkUnaryOperator:   return "UnaryOperatorNode";
+			case N::nkBlock:           return "BlockNode";
+			case N::nkIf:              return "IfNode";
+			case N::nkLoop:            return "LoopNode";
+			case N::nkEach:            return "EachNode";
+			case N::nkDefineFunc:      return "DefineFuncNode";
+			case N::nkTypeName:        return "TypeNameNode";
+			case N::nkType:            return "TypeNode";
+			case N::nkExpression:      return "ExpressionNode";
+			case N::nkFuncCallArgs:    return "FuncCallArgsNode";
+			case N::nkSubscriptIndex:  return "SubscriptIndexNode";
+			case N::nkPrimaryExpr:     return "PrimaryExprNode";
+			case N::nkParenExpr:       return "ParenExprNode";
+			case N::nkTupleExpr:       return "TupleExprNode";
+			case N::nkTupleType:       return "TupleTypeNode";
+			case N::nkDeclVar:         return "DeclVarNode";
+			case N::nkDeclConst:       return "DeclConstNode";
+			case N::nkAssign:          return "AssignNode";
+			case N::nkReturn:          return "ReturnNode";
+			case N::nkField:           return "FieldNode";
+			case N::nkBreak:           return "BreakNode";
+			case N::nkDefineName:      return "DefineNameNode";
+			case N::nkDefineStruct:    return "DefineStructNode";
+			case N::nkDefineImpl:      return "DefineImplNode";
+			case N::nkDefineInterface: return "DefineInterfaceNode";
+			}
+			return "";
+		}
+
+		AST::Node* create(AST& ast, AST::Node::Kind k) {
+			typedef AST::Node N;
+			switch (k) {
+			case N::nkLiteral:         return ast.createNode<AST::LiteralNode>();
+			case N::nkIdentifier:      return ast.createNode<AST::IdentifierNode>();
+			case N::nkOperator:        return ast.createNode<AST::OperatorNode>();
+			case N::nkBinaryOperator:  return ast.createNode<AST::BinaryOperatorNode>();
+			case N::nkFuncCall:        return ast.createNode<AST::FuncCallNode>();
+			case N::nkSubscript:       return ast.createNode<AST::SubscriptNode>();
+			case N::nkUnaryOperator:   return ast.createNode<AST::UnaryOperatorNode>();
+			case N::nkBlock:           return ast.createNode<AST::BlockNode>();
+			case N::nkIf:              return ast.createNode<AST::IfNode>();
+			case N::nkLoop:            return ast.createNode<AST::LoopNode>();
+			case N::nkEach:            return ast.createNode<AST::EachNode>();
+			case N::nkDefineFunc:      return ast.createNode<AST::DefineFuncNode>();
+			case N::nkTypeName:        return ast.createNode<AST::TypeNameNode>();
+			case N::nkType:            return ast.createNode<AST::TypeNode>();
+			case N::nkExpression:      return ast.createNode<AST::ExpressionNode>();
+			case N::nkFuncCallArgs:    return ast.createNode<AST::FuncCallArgsNode>();
+			case N::nkSubscriptIndex:  return ast.createNode<AST::SubscriptIndexNode>();
+			case N::nkPrimaryExpr:     return ast.createNode<AST::PrimaryExprNode>();
+			case N::nkParenExpr:       return ast.createNode<AST::ParenExprNode>();
+			case N::nkTupleExpr:       return ast.createNode<AST::TupleExprNode>();
+			case N::nkTupleType:       return ast.createNode<AST::TupleTypeNode>();
+			case N::nkDeclVar:         return ast.createNode<AST::DeclVarNode>();
+			case N::nkDeclConst:       return ast.createNode<AST::DeclConstNode>();
+			case N::nkAssign:          return ast.createNode<AST::AssignNode>(nullptr);
+			case N::nkReturn:          return ast.createNode<AST::ReturnNode>();
+			case N::nkField:           return ast.createNode<AST::FieldNode>();
+			case N::nkBreak:           return ast.createNode<AST::BreakNode>();
+			case N::nkDefineName:      return ast.createNode<AST::DefineNameNode>();
+			case N::nkDefineStruct:    return ast.createNode<AST::DefineStructNode>();
+			case N::nkDefineImpl:      return ast.createNode<AST::DefineImplNode>();
+			case N::nkDefineInterface: return ast.createNode<AST::DefineInterfaceNode>();
+			}
+			return nullptr;
+		}
+
+		const int KindCount = AST::Node::nkDefineInterface + 1;
+
+		// an empty node of each kind, for valid() to ask forEachField what
+		// a kind's slots hold
+		struct Prototypes {
+			AST        ast{ nullptr };
+			AST::Node* of[KindCount];
+
+			Prototypes() {
+				for (int k = 0; k < KindCount; k++) of[k] = create(ast, (AST::Node::Kind)k);
+			}
+		};
+
+		Prototypes& prototypes() {
+			static Prototypes p;
+			return p;
+		}
+
+		// whether a member declared T* may hold node n. Members declared
+		// ExpressionNode* hold whatever the expression parsed to, as Node*
+		// ones do.
+		template <class T>
+		bool fits(AST::Node* n, T*) {
+			return isa<T>(n);
+		}
+		bool fits(AST::Node*, AST::Node*)           { return true; }
+		bool fits(AST::Node*, AST::ExpressionNode*) { return true; }
+		// a tuple or function type stands where a type's name goes, as
+		// TypeNameNode::parse gives them
+		bool fits(AST::Node* n, AST::TypeNameNode*) {
+			return isa<AST::TypeNameNode>(n) || isa<AST::TupleTypeNode>(n) || isa<AST::DefineFuncNode>(n);
+		}
+
+		template <class T>
+		bool holds(uint8_t kind) {
+			return kind < KindCount && fits(prototypes().of[kind], (T*)nullptr);
+		}
+
+		template <class P>
+		using Pointee = typename remove_pointer<typename remove_reference<P>::type>::type;
+
+		bool isSynthetic(Token* t) {
+			return t == nullptr || t == &AST::FuncCallNode::Synthetic ||
+				t == &AST::SubscriptNode::Synthetic || t == &AST::BreakNode::Synthetic;
+		}
+	}
+
+	FlatAST::FlatAST(AST::Node* root) {
+		flatten(root);
+	}
+
+	// Depth first, in the order the parser allocated most nodes, with an
+	// explicit stack so deep trees cannot overflow the C++ one. Each entry
+	// holds a node and the slot of its parent to fill in, so children get
+	// higher indices than their parent.
+	void FlatAST::flatten(AST::Node* root) {
+		typedef AST::Node N;
+		vector<pair<AST::Node*, uint32_t>> stack;
+		if (root != nullptr) stack.push_back({ root, None });
+		// children of the current node, pushed in reverse once it is done
+		vector<pair<AST::Node*, uint32_t>> pending;
+		// its list, which comes after its single children whatever the
+		// order forEachField gives them in
+		vector<AST::Node*> listed;
+
+		while (!stack.empty()) {
+			auto n = stack.back().first;
+			auto parentSlot = stack.back().second;
+			stack.pop_back();
+			if (parentSlot != None) slotBuf[parentSlot] = (uint32_t)nodeBuf.size();
+
+			Node f = { n->kind, 0, 0, None, (uint32_t)slotBuf.size(), 0, 0 };
+			if (!isSynthetic(n->token)) {
+				auto t = n->token;
+				f.token = (uint32_t)tokenBuf.size();
+				tokenBuf.push_back({ t->kind, t->type, 0, t->offset, (uint32_t)textBuf.size(), (uint32_t)t->value.size() });
+				textBuf.append(t->value);
+			}
+
+			auto slot = [&](AST::Node* c) {
+				if (c != nullptr) pending.push_back({ c, (uint32_t)slotBuf.size() });
+				slotBuf.push_back(None);
+			};
+			listed.clear();
+			forEachField(n, [&](TreeField, AST::Node* c) {
+				slot(c);
+				f.fixed++;
+			}, [&](TreeField, auto& list) {
+				listed.assign(list.begin(), list.end());
+			});
+			for (auto c : listed) slot(c);
+
+			if (n->kind == N::nkType) {
+				auto d = cast<AST::TypeNode>(n);
+				f.flags = (d->isRef ? fRef : 0) | (d->isArray ? fArray : 0);
+				f.value = d->arrayLength;
+			} else if (n->kind == N::nkField) {
+				f.flags = cast<AST::FieldNode>(n)->isConst ? fConst : 0;
+			}
+			f.count = (uint32_t)slotBuf.size() - f.first;
+			nodeBuf.push_back(f);
+			stack.insert(stack.end(), pending.rbegin(), pending.rend());
+			pending.clear();
+
+			// every index and offset is 32 bits, with None kept back
+			if (nodeBuf.size() >= None || slotBuf.size() >= None || tokenBuf.size() >= None || textBuf.size() > None) {
+				tooLarge = true;
+				nodeBuf = vector<Node>();
+				slotBuf = vector<uint32_t>();
+				tokenBuf = vector<Token>();
+				textBuf = string();
+				break;
+			}
+		}
+
+		nodes = nodeBuf.data();
+		children = slotBuf.data();
+		tokens = tokenBuf.data();
+		text = textBuf.data();
+		nodeCount = nodeBuf.size();
+		slotCount = slotBuf.size();
+		tokenCount = tokenBuf.size();
+		textSize = textBuf.size();
+	}
+
+	bool FlatAST::save(string path, uint64_t check) const {
+		if (tooLarge) return false;
+		Header h = {};
+		memcpy(h.magic, Magic, sizeof(Magic));
+		h.version = Version;
+		h.order = Order;
+		h.nodes = (uint32_t)nodeCount;
+		h.slots = (uint32_t)slotCount;
+		h.tokens = (uint32_t)tokenCount;
+		h.text = (uint32_t)textSize;
+		h.check = check;
+
+		fstream fs(path, ios::out | ios::binary | ios::trunc);
+		if (!fs.is_open()) return false;
+		fs.write((const char*)&h, sizeof(h));
+		fs.write((const char*)nodes, nodeCount * sizeof(Node));
+		fs.write((const char*)children, slotCount * sizeof(uint32_t));
+		fs.write((const char*)tokens, tokenCount * sizeof(Token));
+		fs.write(text, textSize);
+		return fs.good();
+	}
+
+	// Every array follows the header at a 4-byte boundary, and the file
+	// is mapped at a page boundary, so the arrays are used in place.
+	bool FlatAST::load(string path, uint64_t check) {
+		nodeBuf.clear();
+		slotBuf.clear();
+		tokenBuf.clear();
+		textBuf.clear();
+		nodes = nullptr;
+		nodeCount = slotCount = tokenCount = textSize = 0;
+		tooLarge = false;
+
+		if (!file.open(path, false) || file.size() < sizeof(Header)) return false;
+		Header h;
+		memcpy(&h, file.data(), sizeof(h));
+		if (memcmp(h.magic, Magic, sizeof(Magic)) != 0 || h.version != Version || h.order != Order ||
+			h.check != check) return false;
+
+		size_t need = sizeof(Header) + (size_t)h.nodes * sizeof(Node) + (size_t)h.slots * sizeof(uint32_t) +
+			(size_t)h.tokens * sizeof(Token) + h.text;
+		if (file.size() != need) return false;
+
+		auto p = file.data() + sizeof(Header);
+		nodes = (const Node*)p;
+		p += (size_t)h.nodes * sizeof(Node);
+		children = (const uint32_t*)p;
+		p += (size_t)h.slots * sizeof(uint32_t);
+		tokens = (const Token*)p;
+		p += (size_t)h.tokens * sizeof(Token);
+		text = p;
+		nodeCount = h.nodes;
+		slotCount = h.slots;
+		tokenCount = h.tokens;
+		textSize = h.text;
+
+		if (!valid()) {
+			file.close();
+			nodes = nullptr;
+			nodeCount = slotCount = tokenCount = textSize = 0;
+			return false;
+		}
+		return true;
+	}
+
+	// Checks what inflate() and the accessors rely on: indices in range,
+	// children after their parent, so no walk can loop, and each slot
+	// holding a kind the member it fills may hold, with as many single
+	// slots as the kind has members, so a damaged file cannot make one
+	// node pass for another.
+	bool FlatAST::valid() const {
+		for (size_t i = 0; i < nodeCount; i++) {
+			auto& n = nodes[i];
+			if (n.kind >= KindCount || n.fixed > n.count) return false;
+			if ((size_t)n.first + n.count > slotCount) return false;
+			if (n.token != None) {
+				if (n.token >= tokenCount) return false;
+				auto& t = tokens[n.token];
+				if ((size_t)t.text + t.length > textSize) return false;
+			}
+			for (uint32_t s = 0; s < n.count; s++) {
+				auto c = children[n.first + s];
+				if (c != None && (c <= i || c >= nodeCount)) return false;
+			}
+
+			auto s = slots(n);
+			uint32_t k = 0;
+			bool ok = true, list = false;
+			forEachField(prototypes().of[n.kind], [&](TreeField, auto& member) {
+				if (k >= n.fixed) {
+					ok = false;
+					return;
+				}
+				auto c = s[k++];
+				if (c != None && !holds<Pointee<decltype(member)>>(nodes[c].kind)) ok = false;
+			}, [&](TreeField, auto& items) {
+				list = true;
+				for (auto j = n.fixed; j < n.count; j++) {
+					if (s[j] != None && !holds<Pointee<decltype(items[0])>>(nodes[s[j]].kind)) ok = false;
+				}
+			});
+			if (!ok || k != n.fixed || (!list && n.count != n.fixed)) return false;
+		}
+		return true;
+	}
+
+	// Children are built before their parent by going backwards.
+	AST::Node* FlatAST::inflate(AST& ast) const {
+		typedef AST::Node N;
+		if (nodeCount == 0) return nullptr;
+		vector<AST::Node*> made(nodeCount, nullptr);
+
+		for (size_t i = nodeCount; i-- > 0;) {
+			auto& f = nodes[i];
+			auto s = slots(f);
+			auto n = create(ast, f.kind);
+			uint32_t k = 0;
+			forEachField(n, [&](TreeField, auto& member) {
+				auto c = s[k++];
+				member = c != None ? cast<Pointee<decltype(member)>>(made[c]) : nullptr;
+			}, [&](TreeField, auto& list) {
+				for (auto j = f.fixed; j < f.count; j++) {
+					if (s[j] != None) n->add(list, cast<Pointee<decltype(list[0])>>(made[s[j]]));
+				}
+			});
+
+			switch (f.kind) {
+			case N::nkBinaryOperator:
+			case N::nkFuncCall:
+			case N::nkSubscript: {
+				// the call's and subscript's own names for left and right
+				auto d = cast<AST::BinaryOperatorNode>(n);
+				d->addNodes(d->left, d->right);
+				break;
+			}
+			case N::nkType: {
+				auto d = cast<AST::TypeNode>(n);
+				d->isRef = (f.flags & fRef) != 0;
+				d->isArray = (f.flags & fArray) != 0;
+				d->arrayLength = f.value;
+				break;
+			}
+			case N::nkField:
+				cast<AST::FieldNode>(n)->isConst = (f.flags & fConst) != 0;
+				break;
+			default:
+				break;
+			}
+
+			n->setTypeName(typeName(f.kind));
+			if (f.token != None) {
+				auto& t = tokens[f.token];
+				auto token = ast.createToken(Lang::Token(t.kind, t.type, value(t), t.offset));
+				if (t.kind == Lang::Token::kIdentifier) token->symbol = Interner::global().intern(token->value);
+				n->token = token;
+			}
+			if (f.kind == N::nkIdentifier && n->token != nullptr) cast<AST::IdentifierNode>(n)->symbol = n->token->symbol;
+			made[i] = n;
+		}
+		return made[0];
+	}
+}
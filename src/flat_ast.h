@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "source.h"
+
+using namespace std;
+
+namespace Lang {
+	// An AST as three flat arrays instead of linked heap objects: nodes,
+	// the child slots of every node as 32-bit node indices, and the tokens
+	// the nodes refer to, whose text is gathered in one buffer. Node 0 is
+	// the root and every child comes after its parent.
+	//
+	// save() writes the arrays behind a versioned header; load() maps such
+	// a file, checks its indices and uses the arrays where they lie, with
+	// no parsing and no allocation. inflate() turns it back into AST nodes
+	// for code that walks pointers.
+	class FlatAST {
+	public:
+		// an unset child slot, or the synthetic token of a call, subscript
+		// or break
+		static constexpr uint32_t None = 0xFFFFFFFF;
+		// changes whenever the layout, the node kinds or their slots do;
+		// files of another version are refused
+		static constexpr uint32_t Version = 2;
+
+		enum Flag : uint8_t {
+			fRef   = 1, // TypeNode::isRef
+			fArray = 2, // TypeNode::isArray
+			fConst = 4, // FieldNode::isConst
+		};
+
+		// The slots of a node begin with `fixed` single children in the
+		// order forEachChild visits them, null ones included, followed by
+		// its list (block statements, arguments, fields, ...).
+		struct Node {
+			AST::Node::Kind kind;
+			uint8_t         flags;
+			uint16_t        fixed;
+			uint32_t        token;
+			uint32_t        first;
+			uint32_t        count;
+			// TypeNode::arrayLength
+			int32_t         value;
+		};
+
+		struct Token {
+			Lang::Token::Kind kind;
+			Lang::Token::Type type;
+			uint16_t          unused;
+			uint32_t          offset;
+			// value is text().substr(text, length)
+			uint32_t          text;
+			uint32_t          length;
+		};
+
+		FlatAST() {}
+		// flattens the tree under root; one with more nodes, slots or
+		// tokens than 32-bit indices reach, or more text than 32-bit
+		// offsets do, is left empty and save() refuses it
+		explicit FlatAST(AST::Node* root);
+
+		FlatAST(const FlatAST&) = delete;
+		FlatAST& operator=(const FlatAST&) = delete;
+
+		// check is kept in the header for load to compare, to say what the
+		// tree was made from; false when the file cannot be written or the
+		// tree did not fit the format
+		bool save(string path, uint64_t check = 0) const;
+		// false when path is not a flat AST of this version and byte order,
+		// or was saved with another check
+		bool load(string path, uint64_t check = 0);
+
+		size_t size() const { return nodeCount; }
+
+		const Node& node(uint32_t i) const { return nodes[i]; }
+		// node indices of n's slots, None for unset ones
+		const uint32_t* slots(const Node& n) const { return children + n.first; }
+		const Token& token(uint32_t i) const { return tokens[i]; }
+		string_view value(const Token& t) const {
+			return string_view(text + t.text, t.length);
+		}
+
+		// Builds the tree again in ast, which should have no lexer, and
+		// returns its root. Token values point into this FlatAST, which
+		// must outlive the nodes.
+		AST::Node* inflate(AST& ast) const;
+
+	private:
+		// the arrays, in the buffers below or in the mapped file
+		const Node*      nodes      = nullptr;
+		const uint32_t*  children   = nullptr;
+		const Token*     tokens     = nullptr;
+		const char*      text       = nullptr;
+		size_t           nodeCount  = 0;
+		size_t           slotCount  = 0;
+		size_t           tokenCount = 0;
+		size_t           textSize   = 0;
+		bool             tooLarge   = false;
+
+		vector<Node>     nodeBuf;
+		vector<uint32_t> slotBuf;
+		vector<Token>    tokenBuf;
+		string           textBuf;
+		Source           file;
+
+		void flatten(AST::Node* root);
+		bool valid() const;
+	};
+}
@@ -0,0 +1,32 @@
+#include "interner.h"
+
+namespace Lang {
+	Interner& Interner::global() {
+		static Interner table;
+		return table;
+	}
+
+	Symbol Interner::intern(string_view name) {
+		auto h = hash<string_view>()(name);
+		auto& shard = shards[h % Shards];
+		lock_guard<mutex> g(shard.lock);
+		auto it = shard.ids.find(name);
+		if (it != shard.ids.end()) return it->second;
+
+		shard.names.emplace_back(name);
+		string_view stored = shard.names.back();
+		auto s = ++count;
+		shard.ids.emplace(stored, s);
+
+		lock_guard<mutex> n(namesLock);
+		if (byId.size() < s) byId.resize(s);
+		byId[s - 1] = stored;
+		return s;
+	}
+
+	string_view Interner::name(Symbol s) {
+		lock_guard<mutex> g(namesLock);
+		if (s == 0 || s > byId.size()) return "";
+		return byId[s - 1];
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace Lang {
+	// Dense id of an interned identifier; equal names get equal ids for the
+	// whole process. 0 means no symbol.
+	typedef unsigned Symbol;
+
+	// Process-wide identifier table. Lookups are spread over independently
+	// locked shards so lexers running in parallel rarely wait on each other.
+	class Interner {
+	public:
+		static Interner& global();
+
+		Symbol intern(string_view name);
+		// the text of s, valid for the life of the process
+		string_view name(Symbol s);
+		size_t size() const { return count; }
+
+	private:
+		static const unsigned Shards = 16;
+
+		struct Shard {
+			mutex                              lock;
+			unordered_map<string_view, Symbol> ids;
+			// owns the text the keys of ids point to
+			deque<string>                      names;
+		};
+
+		Shard               shards[Shards];
+		mutex               namesLock;
+		vector<string_view> byId; // byId[s - 1] is the name of s
+		atomic<Symbol>      count{ 0 };
+
+		Interner() {}
+	};
+
+	// Unlocked front for one lexer: an open-addressing table over names that
+	// stay alive with the source, falling back to Interner::global().
+	class SymbolCache {
+	public:
+		Symbol intern(string_view name) {
+			if (used * 2 >= slots.size()) grow();
+			auto mask = slots.size() - 1;
+			for (auto i = hash(name) & mask; ; i = (i + 1) & mask) {
+				auto& e = slots[i];
+				if (e.symbol == 0) {
+					e.name = name;
+					e.symbol = Interner::global().intern(name);
+					used++;
+					return e.symbol;
+				}
+				if (e.name == name) return e.symbol;
+			}
+		}
+
+	private:
+		struct Entry {
+			string_view name;
+			Symbol      symbol = 0;
+		};
+
+		vector<Entry> slots;
+		size_t        used = 0;
+
+		static size_t hash(string_view s) {
+			// FNV-1a, identifiers are short
+			size_t h = 2166136261u;
+			for (auto c : s) h = (h ^ (unsigned char)c) * 16777619u;
+			return h;
+		}
+
+		void grow() {
+			vector<Entry> old(slots.size() < 256 ? 256 : slots.size() * 2);
+			old.swap(slots);
+			auto mask = slots.size() - 1;
+			for (auto& e : old) {
+				if (e.symbol == 0) continue;
+				auto i = hash(e.name) & mask;
+				while (slots[i].symbol != 0) i = (i + 1) & mask;
+				slots[i] = e;
+			}
+		}
+	};
+}
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "define.h"
 #include "token.h"
 #include "lexer.h"
 #include "ast.h"
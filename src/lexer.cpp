@@ -1,7 +1,8 @@
-#include <fstream>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 #include "lexer.h"
-#include "define.h"
+#include "charclass.h"
 
 #ifndef EOF
 #define EOF (-1)
@@ -9,308 +10,244 @@
 #define EOL EOF
 
 namespace Lang {
-	bool Lexer::loadFile(string file) {
-		lines = vector<string>();
-		string endl = getEndl(file);
-		
-		fstream fs(file);
-		if (fs.is_open()) {
-			string str;
-			while (getline(fs, str)) {
-				//cout << "lines: " << lines.size() << ", length: " << str.length() << endl;
-				lines.push_back(str + endl);
-			}
-			row = 0;
-			col = 0;
-			fs.close();
-
-			return true;
-		}
-		return false;
+#ifdef LANG_NO_SIMD
+	bool Lexer::useSimd = false;
+#else
+	bool Lexer::useSimd = true;
+#endif
+
+	void Lexer::load(const Source* src) {
+		buf = src->data();
+		len = src->size();
+		input = src;
+		pos = 0;
 	}
 
 	void Lexer::parse() {
-		if (!loadFile(file)) {
-			throwException("Fail to open file");
-		}
-		while (row < lines.size()) {
-			c = getLineChar(0);
-			//cout << "row: " << row + 1 << ", c: " << c << endl;
-			if (c == EOL) {
-				row++;
-				col = 0;
-				continue;
+		tokens.clear();
+		// typical sources run about four bytes per token
+		tokens.reserve(len / 4);
+		while (scan()) tokens.push_back(cur);
+	}
+
+	Token* Lexer::pull(int i) {
+		if (i < base) return Token::Empty;
+		while (base + (int)window.size() <= i) {
+			if (ended || !scan()) {
+				ended = true;
+				return Token::Empty;
 			}
+			while (base < floor && !window.empty()) {
+				window.pop_front();
+				base++;
+			}
+			while (!literals.empty() && literals.front().token < base) literals.pop_front();
+			window.push_back(cur);
+		}
+		return &window[i - base];
+	}
 
-			ss.str("");
-			char nc = getLineChar(1);
+	// the tokens are not kept, so neither are their literals
+	void Lexer::finish() {
+		while (!ended && scan()) {
+			while (!literals.empty() && literals.back().token >= count()) literals.pop_back();
+		}
+		ended = true;
+	}
 
-			if (c == '"') {
-				fetchString();
+	// Lexes up to and including the next token that is not a comment and
+	// leaves it in cur. Returns false at the end of the source.
+	bool Lexer::scan() {
+		emitted = false;
+		while (!emitted && pos < len) {
+			auto c = buf[pos];
+			char nc = pos + 1 < len ? buf[pos + 1] : EOL;
+
+			switch (Chars.cls[(unsigned char)c]) {
+			case ccSpace:
+				movePtr((unsigned)spaceRun(buf + pos, buf + len, useSimd));
 				continue;
-			}
-			if (c == '/' && nc == '/') {
-				fetchLineComment();
-				continue;
-			}
-			if (c == '/' && nc == '*') {
-				fetchBlockComment();
+			case ccQuote:
+				fetchString();
 				continue;
-			}
-			if (c == '*' && nc == '/') {
-				throwException("error: unmatched block comment");
-			}
-			if (c >= '0' && c <= '9') {
+			case ccDigit:
 				fetchNumber();
 				continue;
-			}
-			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
-				movePtr(1);
+			case ccIdent:
+				fetchIdentifier();
 				continue;
-			}
-			if (c == '-' && nc == '>' || c == '&' && nc == '&' || c == '|' && nc == '|') {
-				ss << c << nc;
-				addToken(ss.str(), Token::Kind::kOperator);
+			case ccSlash:
+				if (nc == '/') {
+					fetchLineComment();
+					continue;
+				}
+				if (nc == '*') {
+					fetchBlockComment();
+					continue;
+				}
+				addOperator(nc == '=' ? 2 : 1);
 				continue;
-			}
-			if (c == '+' || c == '-' || c == '*' || c == '/' || c == '%' || c == '!' || c == '=' || c == '>' || c == '<') {
-				ss << c;
-				if (nc == '=') {
-					ss << '=';
+			case ccStar:
+				if (nc == '/') {
+					error("error: unmatched block comment");
+					movePtr(2);
+					continue;
 				}
-				addToken(ss.str(), Token::Kind::kOperator);
+				addOperator(nc == '=' ? 2 : 1);
 				continue;
-			}
-			if (c == '(' || c == ')' || c == '[' || c == ']' || c == '{' || c == '}' || c == ':' || c == ',' || c == ';' || c == '.' || c == '&') {
-				ss << c;
-				addToken(ss.str(), Token::Kind::kOperator);
+			case ccMinus:
+				addOperator(nc == '>' || nc == '=' ? 2 : 1);
+				continue;
+			case ccAmp:
+				addOperator(nc == '&' ? 2 : 1);
+				continue;
+			case ccPipe:
+				if (nc != '|') break;
+				addOperator(2);
+				continue;
+			case ccOperator:
+				addOperator(nc == '=' ? 2 : 1);
+				continue;
+			case ccPunct:
+				addOperator(1);
 				continue;
 			}
 
-			int i = 0;
-			while (c == '_' || c >= '0' && c <= '9' || c >= 'a' && c <= 'z' || c >= 'A' && c <= 'Z' || c < 0 && c != EOL) {
-				ss << c;
-				c = getLineChar(++i);
-			}
-			
-			addToken(ss.str(), Keywords.find(ss.str()) == Keywords.end() ? Token::Kind::kIdentifier : Token::Kind::kKeyword);
+			stringstream e;
+			e << "error: unexpected character `" << c << "`";
+			error(e.str());
+			movePtr(1);
 		}
+		return emitted;
+	}
+
+	void Lexer::fetchIdentifier() {
+		auto value = string_view(buf + pos, identRun(buf + pos, buf + len, useSimd));
+		auto l = findLexeme(value);
+		if (l != nullptr) {
+			addToken(value, l->kind, l->type);
+			return;
+		}
+		addToken(value, Token::Kind::kIdentifier);
+		cur.symbol = symbols.intern(value);
+	}
+
+	void Lexer::addOperator(unsigned int length) {
+		auto value = string_view(buf + pos, length);
+		auto l = findLexeme(value);
+		addToken(value, Token::Kind::kOperator, l != nullptr ? l->type : Token::Type::tUnknown);
 	}
 
 	void Lexer::fetchString() {
-		movePtr(1);
-		c = getChar(0); // skip the first "
-		int i = 0;
+		movePtr(1); // skip the first "
+		auto begin = buf + pos;
+		auto end = buf + len;
+		auto p = begin;
+		string* unescaped = nullptr;
 		int escapeCnt = 0;
-		while (c != EOF) {
-			if (c == '"') {
-				addToken(ss.str(), Token::Kind::kLiteral, Token::Type::tString);
+		while (p < end) {
+			auto q = findEither(p, end, '"', '\\', useSimd);
+			if (unescaped != nullptr) unescaped->append(p, q);
+			if (q == end) break;
+			if (*q == '"') {
+				auto value = string_view(begin, q - begin);
+				if (unescaped != nullptr) value = *unescaped;
+				addToken(value, Token::Kind::kLiteral, Token::Type::tString);
 				movePtr(1 + escapeCnt);
 				return;
-			} else if (c == '\\') {
-				char nc = getChar(++i);
-				if (nc == '\\') ss << '\\';
-				else if (nc == 't') ss << '\t';
-				else if (nc == 'r') ss << '\r';
-				else if (nc == 'n') ss << '\n';
-				else if (nc == '"') ss << '"';
-				else {
-					stringstream e;
-					e << "error: unknown escape " << '\\' << nc;
-					throwException(e.str());
-				}
-				escapeCnt++;
-			} else {
-				ss << c;
 			}
-			c = getChar(++i);
+			if (unescaped == nullptr) {
+				literals.push_back({ count(), string(begin, q) });
+				unescaped = &literals.back().text;
+			}
+			char nc = q + 1 < end ? q[1] : EOF;
+			if (nc == '\\') unescaped->push_back('\\');
+			else if (nc == 't') unescaped->push_back('\t');
+			else if (nc == 'r') unescaped->push_back('\r');
+			else if (nc == 'n') unescaped->push_back('\n');
+			else if (nc == '"') unescaped->push_back('"');
+			else {
+				stringstream e;
+				e << "error: unknown escape " << '\\' << nc;
+				error(e.str());
+				// kept as the bare character
+				if (nc != EOF) unescaped->push_back(nc);
+			}
+			escapeCnt++;
+			p = q + 2;
 		}
-		throwException("error: unclosed string");
+		error("error: unclosed string");
+		pos = len;
+		cut = true;
 	}
 
 	void Lexer::fetchLineComment() {
-		int i = 0;
-		while (c != EOL && c != '\r' && c != '\n') {
-			ss << c;
-			c = getLineChar(++i);
-		}
-		addToken(ss.str(), Token::Kind::kComment, Token::Type::tLineComment);
-		row++;
-		col = 0;
+		// the line break itself is left to the whitespace scanner
+		auto q = findEither(buf + pos, buf + len, '\r', '\n', useSimd);
+		addToken(string_view(buf + pos, q - (buf + pos)), Token::Kind::kComment, Token::Type::tLineComment);
 	}
 
 	void Lexer::fetchBlockComment() {
 		int clv = 0;
-		int i = 0;
-		while (c != EOF) {
-			ss << c;
-			char nc = getChar(++i);
-			if (c == '/' && nc == '*') { ss << nc; i++; clv++; }
-			if (c == '*' && nc == '/') { ss << nc; i++; clv--; }
+		auto end = buf + len;
+		auto q = buf + pos;
+		while (q < end) {
+			q = findEither(q, end, '/', '*', useSimd);
+			if (q == end) break;
+			char nc = q + 1 < end ? q[1] : EOF;
+			if (*q == '/' && nc == '*') clv++;
+			else if (*q == '*' && nc == '/') clv--;
+			else {
+				q++;
+				continue;
+			}
+			q += 2;
 			if (clv == 0) {
-				addToken(ss.str(), Token::Kind::kComment, Token::Type::tBlockComment);
+				addToken(string_view(buf + pos, q - (buf + pos)), Token::Kind::kComment, Token::Type::tBlockComment);
 				return;
 			}
-			c = getChar(i);
 		}
-		throwException("error: unclosed block comment");
+		error("error: unclosed block comment");
+		pos = len;
+		cut = true;
 	}
 
 	void Lexer::fetchNumber() {
+		auto p = buf + pos;
+		auto end = buf + len;
+		auto i = digitRun(p, end, useSimd);
 		bool hasDot = false;
-		int i = 0;
-		while (c != EOF) {
-			if (c == '.') {
-				if (hasDot) break;
-				char nc = getChar(i + 1);
-				if (!(nc >= '0' && nc <= '9')) break;
-				hasDot = true;
-				ss << c;
-			} else if (c >= '0' && c <= '9') {
-				ss << c;
-			} else {
-				break;
-			}
-			c = getChar(++i);
+		if (p + i + 1 < end && p[i] == '.' && Chars.cls[(unsigned char)p[i + 1]] == ccDigit) {
+			hasDot = true;
+			i += 1 + digitRun(p + i + 1, end, useSimd);
 		}
-		addToken(ss.str(), Token::Kind::kLiteral, hasDot ? Token::Type::tFloat : Token::Type::tInteger);
+		addToken(string_view(p, i), Token::Kind::kLiteral, hasDot ? Token::Type::tFloat : Token::Type::tInteger);
 	}
 
-
-	
-
-	void Lexer::addToken(string value, Token::Kind kind, Token::Type type) {
-		auto token = new Token(kind, type, value, row + 1, col + 1);
-		tokenList.push_back(token);
+	void Lexer::addToken(string_view value, Token::Kind kind, Token::Type type) {
+		auto offset = (unsigned)pos;
 		movePtr((unsigned)value.length());
+		if (kind == Token::Kind::kComment) return;
 
-		if (kind == Token::Kind::kKeyword && (value == "true" || value == "false")) {
-			token->kind = Token::Kind::kLiteral;
-			token->type = Token::Type::tBoolean;
-		}
-		if (kind == Token::Kind::kKeyword) {
-			if (value == "var") token->type = Token::Type::tDeclareVar;
-			if (value == "const") token->type = Token::Type::tDeclareConst;
-			if (value == "if") token->type = Token::Type::tIf;
-			if (value == "else") token->type = Token::Type::tElse;
-			if (value == "loop") token->type = Token::Type::tLoop;
-			if (value == "break") token->type = Token::Type::tBreak;
-			if (value == "continue") token->type = Token::Type::tContinue;
-		}
-		if (kind == Token::Kind::kOperator) {
-			if (value == "+") token->type = Token::Type::tPlus;
-			else if (value == "-") token->type = Token::Type::tMinus;
-			else if (value == "*") token->type = Token::Type::tMulit;
-			else if (value == "/") token->type = Token::Type::tDivide;
-			else if (value == "%") token->type = Token::Type::tModulus;
-
-			else if (value == "==") token->type = Token::Type::tEqual;
-			else if (value == "<") token->type = Token::Type::tLessThan;
-			else if (value == "<=") token->type = Token::Type::tLessEqual;
-			else if (value == "!=") token->type = Token::Type::tNotEqual;
-			else if (value == ">") token->type = Token::Type::tGreaterThan;
-			else if (value == ">=") token->type = Token::Type::tGreaterEqual;
-
-			else if (value == "&&") token->type = Token::Type::tLogicAnd;
-			else if (value == "||") token->type = Token::Type::tLogicOr;
-			else if (value == "!") token->type = Token::Type::tLogicNot;
-
-			else if (value == "&") token->type = Token::Type::tBinOpAnd;
-			else if (value == "|") token->type = Token::Type::tBinOpOr;
-			else if (value == "^") token->type = Token::Type::tBinOpXor;
-			else if (value == "~") token->type = Token::Type::tBinOpNot;
-			else if (value == "<<") token->type = Token::Type::tBinOpLShift;
-			else if (value == ">>") token->type = Token::Type::tBinOpRShift;
-
-			else if (value == ".") token->type = Token::Type::tDot;
-			else if (value == ",") token->type = Token::Type::tComma;
-			else if (value == ";") token->type = Token::Type::tSemicolon;
-			else if (value == ":") token->type = Token::Type::tColon;
-
-			else if (value == "(") token->type = Token::Type::tLParen;
-			else if (value == ")") token->type = Token::Type::tRParen;
-			else if (value == "[") token->type = Token::Type::tLBracket;
-			else if (value == "]") token->type = Token::Type::tRBracket;
-			else if (value == "{") token->type = Token::Type::tLBrace;
-			else if (value == "}") token->type = Token::Type::tRBrace;
-
-			else if (value == "=") token->type = Token::Type::tAssign;
-		}
-
+		cur = Token(kind, type, value, offset);
+		cur.inStream = true;
+		emitted = true;
 	}
 
 	void Lexer::movePtr(unsigned int offset) {
-		col += offset;
-		while (row < lines.size()) {
-			auto str = lines[row];
-			if (col >= str.length()) {
-				col -= (unsigned)str.length();
-				row++;
-				continue;
-			}
-			break;
-		}
+		pos += offset;
+		if (pos > len) pos = len;
 	}
 
-	char Lexer::getChar(unsigned int offset) {
-		auto r = row;
-		auto c = col + offset;
-		while (r < lines.size()) {
-			auto str = lines[r];
-			if (c >= str.length()) {
-				c -= (unsigned)str.length();
-				r++;
-				continue;
-			}
-			return str[c];
-		}
-		return EOF;
+	// Reports e at the current position. The caller skips past the bad
+	// input and lexing goes on, so one pass finds every lexical error.
+	void Lexer::error(string e) {
+		int row, col;
+		getPosition((unsigned)pos, &row, &col);
+		diags.report(row, col, move(e));
 	}
 
-	char Lexer::getLineChar(unsigned int offset) {
-		auto c = col + offset;
-		auto str = lines[row];
-		if (c < str.length()) {
-			return str[c];
-		}
-		return EOL;
-	}
-
-	string Lexer::getEndl(string file) {
-		stringstream ss;
-
-		fstream fs(file, ios::in | ios::binary);
-		if (fs.is_open()) {
-			while (!fs.eof()) {
-				char c = fs.get();
-				if (c == '\r') {
-					ss << c;
-					c = fs.get();
-					if (c == '\n') ss << c;
-					break;
-				} else if (c == '\n') {
-					ss << c;
-					break;
-				}
-			}
-			fs.close();
-		}
-		if (ss.str().length() == 0) ss << endl;
-		return ss.str();
-	}
-
-	void Lexer::throwException(string e) {
-		cout << "[" << row + 1 << "," << col + 1 << "] ";
-		throw exception(e.c_str());
-	}
-
-	void Lexer::makeArray() {
-		for (auto t : tokenList) {
-			if (t->isComment()) continue;
-
-			t->index = (int)tokens.size();
-			t->lex = this;
-			tokens.push_back(t);
-		}
+	void Lexer::getPosition(unsigned offset, int* r, int* c) {
+		input->position(offset, r, c);
 	}
 }
\ No newline at end of file
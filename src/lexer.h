@@ -2,9 +2,11 @@
 
 #include <string>
 #include <vector>
-#include <list>
+#include <deque>
 #include <sstream>
 #include "token.h"
+#include "source.h"
+#include "diagnostic.h"
 
 using namespace std;
 
@@ -12,41 +14,116 @@ namespace Lang {
 	class Lexer {
 	public:
 		Lexer(string path) {
-			tokens = vector<Token*>();
-			tokenList = list<Token*>();
 			file = path;
+			if (!source.open(file)) diags.report(0, 0, "Fail to open file");
+			load(&source);
 			parse();
-			makeArray();
 		}
 
-		vector<Token*> tokens;
+		// Lexes a source the caller already loaded, which must outlive the
+		// lexer. A streaming lexer produces tokens only as at() asks for them
+		// and keeps just the window the parser can still reach.
+		Lexer(const Source* src, bool stream = false) {
+			load(src);
+			streaming = stream;
+			if (!streaming) parse();
+		}
+
+		bool isStreaming() {
+			return streaming;
+		}
+
+		// tokens lexed so far, which is all of them unless streaming
+		int count() {
+			return streaming ? base + (int)window.size() : (int)tokens.size();
+		}
+
+		Token* at(int i) {
+			if (streaming) return pull(i);
+			if (i >= 0 && i < (int)tokens.size()) return &tokens[i];
+			return Token::Empty;
+		}
+
+		// Streaming: tokens before i will not be asked for again. The last
+		// Lookback of them stay valid so recent at() results can still be used.
+		void release(int i) {
+			floor = i - Lookback;
+		}
+
+		// Streaming: lexes the rest of the source without keeping it, so
+		// lexical errors past where the parser stopped are still reported.
+		void finish();
+
+		void getPosition(unsigned offset, int* r, int* c);
+
+		// whether t's value is held by the lexer rather than the source; a
+		// streaming lexer lets it go once t leaves the window
+		bool ownsValue(const Token* t) {
+			return t->value.data() < buf || t->value.data() >= buf + len;
+		}
+
+		// an unclosed string or block comment ran to the end of the source
+		bool unterminated() {
+			return cut;
+		}
+
+		// lexical errors, and the parse errors of an AST over this lexer
+		Diagnostics& diagnostics() {
+			return diags;
+		}
+
+		// use the SSE2/AVX2 scanners where compiled in
+		static bool useSimd;
 
 	private:
 		string         file;
 
-		vector<string> lines;
-		unsigned int   row = 0;
-		unsigned int   col = 0;
+		Source         source;
+		const char*    buf = nullptr;
+		size_t         len = 0;
+		size_t         pos = 0;
+		// the source lexed: source, or the one the caller loaded
+		const Source*  input = nullptr;
+
+		vector<Token>  tokens;
+		// the token scan() produced
+		Token          cur;
+		bool           emitted = false;
+		bool           cut     = false;
 
-		list<Token*> tokenList;
+		static const int Lookback = 16;
+		bool           streaming = false;
+		// window[0] is token number base
+		deque<Token>   window;
+		int            base  = 0;
+		int            floor = 0;
+		bool           ended = false;
 
-		bool loadFile(string file);
+		// unescaped string literals, the only token values not in buf, by
+		// the number of their token; streaming drops them along with it
+		struct Literal {
+			int    token;
+			string text;
+		};
+		deque<Literal> literals;
+		// identifiers seen in this file, so the shared table is asked once per name
+		SymbolCache    symbols;
+		Diagnostics    diags;
+
+		void load(const Source* src);
 
-		char c;
-		stringstream ss;
 		void parse();
+		bool scan();
+		Token* pull(int i);
+		void fetchIdentifier();
+		void addOperator(unsigned int length);
 		void fetchString();
 		void fetchLineComment();
 		void fetchBlockComment();
 		void fetchNumber();
 
-		void addToken(string value, Token::Kind kind = Token::Kind::kUnknown, Token::Type type = Token::Type::tUnknown);
+		void addToken(string_view value, Token::Kind kind = Token::Kind::kUnknown, Token::Type type = Token::Type::tUnknown);
 		void movePtr(unsigned int offset);
-		char getChar(unsigned int offset);
-		char getLineChar(unsigned int offset);
-		string getEndl(string file);
-		void throwException(string e);
-
-		void makeArray();
+		void error(string e);
 	};
 }
@@ -6,47 +6,288 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include "util.h"
+#include "utf8.h"
+#include "pool.h"
+#include "parse_cache.h"
+#include "ast_writer.h"
+#include "stats.h"
 
-string createASTHtml(Lang::AST::Node* node);
 //string printNode(Lang::AST::Node* node);
 
-int main()
+struct Options {
+	// compare with the saved output instead of writing it
+	bool              runTest = false;
+	// lex on demand instead of tokenizing each file up front
+	bool              stream  = false;
+	// parsed trees of unchanged sources, nullptr when not caching
+	Lang::ParseCache* cache   = nullptr;
+	// on a cache hit, keep an existing output instead of writing it again
+	bool              reuse   = false;
+	// parses the declarations of a file at the same time, nullptr for one
+	// at a time
+	Lang::WorkPool*   threads = nullptr;
+	// how deep blocks and brackets may nest, 0 for no limit
+	int               maxDepth = Lang::AST::DefaultMaxDepth;
+	// what the tree of each file is written as
+	Lang::TreeFormat  format   = Lang::TreeFormat::Html;
+};
+
+// Saves root next to f in the chosen format, or compares it with the
+// saved one as it is written, so neither is ever held whole. A difference
+// is reported with its offset and the node being written there. Returns
+// how many bytes the output came to.
+size_t writeOutput(string f, const Lang::Source& source, Lang::AST::Node* root, const Options& opt, string& message)
 {
-	bool runTest = false;
-	try {
-		auto list = getFiles("rw");
-		for (auto f : list) {
-			if (runTest) cout << "testing " << f << "... ";
-			else         cout << "parsing " << f << "... ";
-
-			if (!isUTF8(getFileContent(f))) {
-				cout << "FAILED" << endl;
-				cout << "UTF-8 required" << endl;
-				continue;
-			}
+	auto path = f + Lang::treeFormatExtension(opt.format);
+	auto binary = Lang::isBinaryTreeFormat(opt.format);
+	Lang::Sink out;
+	bool ok = opt.runTest ? out.compare(path, binary) : out.open(path, binary);
+	if (!ok) {
+		message = opt.runTest ? "FAILED\nNo " + path + " to compare with" : "FAILED\nFail to write " + path;
+		return 0;
+	}
+	Lang::writeTree(out, root, opt.format);
+	auto size = out.size();
+	if (out.close()) {
+		message = "OK";
+		return size;
+	}
+	if (!opt.runTest) {
+		message = "FAILED\nFail to write " + path;
+		return size;
+	}
+	auto at = out.differsAt();
+	message = "FAILED\n" + path + " differs at byte " + to_string(at);
+	auto spot = Lang::findInOutput(root, opt.format, at);
+	if (spot.node != nullptr) message += string(", in ") + Lang::treeKindName(spot.node->kind);
+	if (spot.token != nullptr) {
+		int row, col;
+		source.position(spot.token->offset, &row, &col);
+		message += " at [" + to_string(row) + "," + to_string(col) + "]";
+	}
+	return size;
+}
 
-			auto lexer = new Lang::Lexer(f);
-			//saveLex(lexer->tokens);
-			auto ast = new Lang::AST(lexer);
-			auto root = ast->parse();
-
-			if (runTest) {
-				if (sameToFile(f + ".html", createASTHtml(root))) {
-					cout << "OK" << endl;
-				} else {
-					cout << "FAILED" << endl;
-				}
+// Lexes and parses one file, then saves or checks its tree. message gets
+// the status shown after "parsing f... "; false means the source has
+// errors, all of which are listed in message. With stats, the time of
+// each phase and the figures of the file go there.
+bool processFile(string f, const Options& opt, string& message, Lang::FileStats* stats = nullptr)
+{
+	if (stats != nullptr) {
+		stats->file = f;
+		stats->start();
+	}
+	Lang::Source source;
+	if (!source.open(f)) {
+		message = "FAILED\nFail to open file";
+		return true;
+	}
+	auto enc = source.encoding();
+	if (stats != nullptr) {
+		stats->mark(Lang::FileStats::phRead);
+		stats->bytes = source.size();
+		stats->countLines(source.data(), source.size());
+	}
+	if (enc != Lang::Source::eUTF8 && enc != Lang::Source::eUTF8BOM) {
+		message = string("FAILED\nUTF-8 required, found ") + Lang::Source::name(enc);
+		return true;
+	}
+
+	// a hit was valid UTF-8 and parsed without errors when it was stored
+	Lang::ParseCache::Key key;
+	if (opt.cache != nullptr) {
+		key = Lang::ParseCache::key(source.data(), source.size());
+		Lang::FlatAST flat;
+		if (opt.cache->load(key, flat)) {
+			if (stats != nullptr) stats->cached = true;
+			if (opt.reuse && !opt.runTest && fileExists(f + Lang::treeFormatExtension(opt.format))) {
+				if (stats != nullptr) stats->mark(Lang::FileStats::phParse);
+				message = "OK";
+				return true;
+			}
+			Lang::AST ast(nullptr);
+			auto root = flat.inflate(ast);
+			if (stats != nullptr) stats->mark(Lang::FileStats::phParse);
+			auto size = writeOutput(f, source, root, opt, message);
+			if (stats != nullptr) {
+				stats->mark(Lang::FileStats::phWrite);
+				stats->output = size;
+				stats->countNodes(root);
+				ast.memory(stats->arenaBytes, stats->arenaBlocks);
 			}
-			else {
-				saveToFile(f + ".html", createASTHtml(root));
-				cout << "OK" << endl;
+			return true;
+		}
+		// the time a missed cache lookup took goes to the parse phase, not to
+		// the UTF-8 check after it
+		if (stats != nullptr) stats->mark(Lang::FileStats::phParse);
+	}
+
+	size_t bad;
+	if (!isUTF8(source.data(), source.size(), &bad)) {
+		message = "FAILED\nUTF-8 required, invalid byte at offset " + to_string(bad);
+		return true;
+	}
+	if (stats != nullptr) stats->mark(Lang::FileStats::phUtf8);
+
+	Lang::Lexer lexer(&source, opt.stream);
+	//saveLex(lexer->tokens);
+	if (stats != nullptr) stats->mark(Lang::FileStats::phLex);
+	Lang::AST ast(&lexer);
+	ast.maxDepth = opt.maxDepth;
+	auto root = opt.threads != nullptr ? ast.parse(*opt.threads) : ast.parse();
+	if (stats != nullptr) {
+		stats->mark(Lang::FileStats::phParse);
+		stats->tokens = lexer.count();
+	}
+	if (!ast.diagnostics().empty()) {
+		message = "FAILED\n" + ast.diagnostics().str();
+		return false;
+	}
+
+	if (opt.cache != nullptr) opt.cache->store(key, Lang::FlatAST(root));
+	auto size = writeOutput(f, source, root, opt, message);
+	if (stats != nullptr) {
+		stats->mark(Lang::FileStats::phWrite);
+		stats->output = size;
+		stats->countNodes(root);
+		ast.memory(stats->arenaBytes, stats->arenaBlocks);
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt;
+	// --jobs N parses N files at a time, 0 means one per hardware thread;
+	// --test checks one per hardware thread unless told otherwise
+	int jobs = 1;
+	bool jobsGiven = false;
+	// --threads N parses the declarations of each file on N threads
+	int threads = 1;
+	// --cache DIR keeps parsed trees in DIR, --cache-size MB bounds it
+	string cacheDir;
+	uint64_t cacheSize = 256;
+	// --stats prints where the time of each file went, --stats=json as JSON
+	bool stats = false;
+	bool statsJson = false;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+			jobs = atoi(argv[++i]);
+			jobsGiven = true;
+		} else if (arg.compare(0, 7, "--jobs=") == 0) {
+			jobs = atoi(arg.c_str() + 7);
+			jobsGiven = true;
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (arg == "--test") {
+			opt.runTest = true;
+		} else if (arg == "--stats" || arg == "--stats=table") {
+			stats = true;
+		} else if (arg == "--stats=json") {
+			stats = statsJson = true;
+		} else if (arg == "--stream") {
+			opt.stream = true;
+		} else if (arg == "--cache" && i + 1 < argc) {
+			cacheDir = argv[++i];
+		} else if (arg == "--cache-size" && i + 1 < argc) {
+			cacheSize = strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--cache-reuse") {
+			opt.reuse = true;
+		} else if (arg == "--max-depth" && i + 1 < argc) {
+			opt.maxDepth = atoi(argv[++i]);
+		} else if (arg.compare(0, 9, "--format=") == 0 || (arg == "--format" && i + 1 < argc)) {
+			// --format=html|json|sexpr|bin
+			string name = arg == "--format" ? argv[++i] : arg.substr(9);
+			if (!Lang::parseTreeFormat(name, opt.format)) {
+				cout << "unknown format " << name << endl;
+				return 1;
 			}
+		} else {
+			cout << "unknown option " << arg << endl;
+			return 1;
 		}
-	} catch (exception e) {
-		cout << endl << e.what() << endl;
-		system("pause");
 	}
+
+	if (opt.runTest && !jobsGiven) jobs = 0;
+
+	// a pool of its own, so a file parsed on the --jobs pool can wait for it
+	unique_ptr<Lang::WorkPool> declPool;
+	if (threads != 1) {
+		declPool.reset(new Lang::WorkPool(threads < 0 ? 0 : (unsigned)threads));
+		opt.threads = declPool.get();
+	}
+
+	unique_ptr<Lang::ParseCache> cache;
+	if (!cacheDir.empty()) {
+		cache.reset(new Lang::ParseCache(cacheDir, cacheSize << 20));
+		opt.cache = cache.get();
+	}
+
+	auto list = getFiles("rw");
+	auto verb = opt.runTest ? "testing " : "parsing ";
+	bool failed = false;
+	// files whose output was not written or not the same as the saved one
+	size_t broken = 0;
+	vector<Lang::FileStats> fileStats(stats ? list.size() : 0);
+	auto statsOf = [&](size_t i) { return stats ? &fileStats[i] : nullptr; };
+
+	if (jobs == 1) {
+		for (size_t i = 0; i < list.size(); i++) {
+			auto& f = list[i];
+			cout << verb << f << "... ";
+			string message;
+			if (!processFile(f, opt, message, statsOf(i))) failed = true;
+			if (message != "OK") broken++;
+			cout << message << endl;
+		}
+	} else {
+		// files finish in any order but are reported in list order
+		vector<string> messages(list.size());
+		vector<char>   state(list.size(), 0); // 0 running, 1 ok, 2 error
+		mutex lock;
+		condition_variable ready;
+
+		Lang::WorkPool pool(jobs < 0 ? 0 : (unsigned)jobs);
+		for (size_t i = 0; i < list.size(); i++) {
+			pool.submit([&, i] {
+				string message;
+				bool ok = processFile(list[i], opt, message, statsOf(i));
+				lock_guard<mutex> g(lock);
+				messages[i] = move(message);
+				state[i] = ok ? 1 : 2;
+				ready.notify_all();
+			});
+		}
+		for (size_t i = 0; i < list.size(); i++) {
+			unique_lock<mutex> g(lock);
+			ready.wait(g, [&] { return state[i] != 0; });
+			if (state[i] == 2) failed = true;
+			auto message = move(messages[i]);
+			if (message != "OK") broken++;
+			g.unlock();
+			cout << verb << list[i] << "... " << message << endl;
+		}
+		pool.wait();
+	}
+
+	if (cache) {
+		auto st = cache->stats();
+		cout << "cache: " << st.hits << " hits, " << st.misses << " misses, " << st.stores << " stored, "
+			<< st.evictions << " evicted, " << st.files << " files in " << (st.bytes + 1023) / 1024 << " KB" << endl;
+	}
+
+	if (stats) Lang::printStats(cout, fileStats, statsJson);
+
+	if (opt.runTest) {
+		cout << list.size() - broken << " of " << list.size() << " passed" << endl;
+		return broken > 0 ? 1 : 0;
+	}
+
+	if (failed) system("pause");
 	
     return 0;
 }
@@ -70,19 +311,6 @@ int main()
 //	fs.close();
 //}
 
-string createASTHtml(Lang::AST::Node* node) {
-	node->print();
-	stringstream ss;
-	ss << "<!DOCTYPE html><html><head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\" /><style type=\"text/css\">";
-	ss << "td{ vertical-align: top; }";
-	ss << "span{ display: block; text-align:center; }";
-	ss << "div{ border-style: solid; border-width: 1px; text-align:center; padding:2px; }";
-	ss << "</style></head><body><table><tr><td>";
-	ss << node->ast->printBuf.str();
-	ss << "</td></tr></table></body></html>";
-	return ss.str();
-}
-
 //string printNode(Lang::AST::Node* node) {
 //	string s = "<div>";
 //	s += "<span>" + node->token->value + "</span>";
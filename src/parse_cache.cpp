@@ -0,0 +1,251 @@
+#include "parse_cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+namespace Lang {
+	namespace {
+		const char* Ext = ".ast";
+
+		struct File {
+			string   name;
+			uint64_t size;
+			uint64_t time;
+		};
+
+		// the cache files in dir with their size and modification time
+		vector<File> listFiles(const string& dir) {
+			vector<File> files;
+#ifdef _WIN32
+			WIN32_FIND_DATAA ffd;
+			HANDLE h = FindFirstFileA((dir + "\\*" + Ext).c_str(), &ffd);
+			if (h == INVALID_HANDLE_VALUE) return files;
+			do {
+				if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+				uint64_t size = ((uint64_t)ffd.nFileSizeHigh << 32) | ffd.nFileSizeLow;
+				uint64_t time = ((uint64_t)ffd.ftLastWriteTime.dwHighDateTime << 32) | ffd.ftLastWriteTime.dwLowDateTime;
+				files.push_back({ ffd.cFileName, size, time });
+			} while (FindNextFileA(h, &ffd) != 0);
+			FindClose(h);
+#else
+			DIR* dp = opendir(dir.c_str());
+			if (!dp) return files;
+			struct dirent* entry;
+			while ((entry = readdir(dp)) != NULL) {
+				string name = entry->d_name;
+				if (name.size() <= strlen(Ext) || name.compare(name.size() - strlen(Ext), string::npos, Ext) != 0) continue;
+				struct stat st;
+				if (stat((dir + "/" + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+				files.push_back({ name, (uint64_t)st.st_size, (uint64_t)st.st_mtime });
+			}
+			closedir(dp);
+#endif
+			return files;
+		}
+
+		uint64_t fileSize(const string& path) {
+#ifdef _WIN32
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return 0;
+			return ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+			struct stat st;
+			return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+#endif
+		}
+
+		void makeDir(const string& dir) {
+#ifdef _WIN32
+			CreateDirectoryA(dir.c_str(), NULL);
+#else
+			mkdir(dir.c_str(), 0755);
+#endif
+		}
+
+		// marks a file as just used
+		void touch(const string& path) {
+#ifdef _WIN32
+			HANDLE f = CreateFileA(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (f == INVALID_HANDLE_VALUE) return;
+			FILETIME now;
+			GetSystemTimeAsFileTime(&now);
+			SetFileTime(f, NULL, NULL, &now);
+			CloseHandle(f);
+#else
+			utime(path.c_str(), nullptr);
+#endif
+		}
+
+		// replaces to with from in one step, so readers see the old file or
+		// the new one, never a partial write
+		bool replace(const string& from, const string& to) {
+#ifdef _WIN32
+			return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			return rename(from.c_str(), to.c_str()) == 0;
+#endif
+		}
+
+		inline uint64_t rotl(uint64_t x, int r) {
+			return (x << r) | (x >> (64 - r));
+		}
+
+		inline uint64_t fmix(uint64_t k) {
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdull;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ull;
+			k ^= k >> 33;
+			return k;
+		}
+	}
+
+	ParseCache::ParseCache(string dir, uint64_t limit) : dir(dir), limit(limit) {
+		makeDir(dir);
+		scan();
+		lock_guard<mutex> g(lock);
+		trim("");
+	}
+
+	// Murmur-style mixing of 8-byte words in two lanes, as MurmurHash3's
+	// 128-bit variant does; it only has to tell sources apart, and runs at
+	// memory speed on the sizes we parse.
+	ParseCache::Key ParseCache::key(const char* data, size_t size) {
+		const uint64_t c1 = 0x87c37b91114253d5ull;
+		const uint64_t c2 = 0x4cf5ad432745937full;
+		uint64_t seed = (uint64_t)AST::Version << 32 | FlatAST::Version;
+		uint64_t h1 = seed ^ (size * c1);
+		uint64_t h2 = seed ^ (size * c2);
+
+		auto mix = [&](uint64_t k) {
+			auto k1 = rotl(k * c1, 31) * c2;
+			auto k2 = rotl(k * c2, 33) * c1;
+			h1 ^= k1;
+			h1 = (rotl(h1, 27) + h2) * 5 + 0x52dce729;
+			h2 ^= k2;
+			h2 = (rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+		};
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t k;
+			memcpy(&k, data + i, 8);
+			mix(k);
+		}
+		uint64_t k = 0;
+		for (size_t j = 0; i + j < size; j++) k |= (uint64_t)(unsigned char)data[i + j] << (j * 8);
+		mix(k);
+
+		h1 ^= size;
+		h2 ^= size;
+		h1 += h2;
+		h2 += h1;
+		h1 = fmix(h1);
+		h2 = fmix(h2);
+		h1 += h2;
+		h2 += h1;
+		return { h1, h2 };
+	}
+
+	bool ParseCache::load(const Key& key, FlatAST& flat) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)key.name, Ext);
+
+		{
+			lock_guard<mutex> g(lock);
+			auto it = index.find(name);
+			if (it == index.end()) {
+				counts.misses++;
+				return false;
+			}
+			order.splice(order.end(), order, it->second);
+		}
+
+		// a file that is damaged, or is the tree of another source whose
+		// name collides, is dropped so it is stored again
+		auto p = path(name);
+		if (!flat.load(p, key.check)) {
+			lock_guard<mutex> g(lock);
+			auto it = index.find(name);
+			if (it != index.end()) {
+				counts.bytes -= it->second->size;
+				counts.files--;
+				order.erase(it->second);
+				index.erase(it);
+			}
+			remove(p.c_str());
+			counts.misses++;
+			return false;
+		}
+		touch(p);
+		lock_guard<mutex> g(lock);
+		counts.hits++;
+		return true;
+	}
+
+	void ParseCache::store(const Key& key, const FlatAST& flat) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)key.name, Ext);
+		auto p = path(name);
+		auto temp = p + ".tmp" + to_string(temps++);
+		if (!flat.save(temp, key.check) || !replace(temp, p)) {
+			remove(temp.c_str());
+			return;
+		}
+
+		auto size = fileSize(p);
+		lock_guard<mutex> g(lock);
+		auto it = index.find(name);
+		if (it != index.end()) {
+			counts.bytes -= it->second->size;
+			order.erase(it->second);
+		} else {
+			counts.files++;
+		}
+		order.push_back({ name, size });
+		index[name] = prev(order.end());
+		counts.bytes += size;
+		counts.stores++;
+		trim(name);
+	}
+
+	ParseCache::Stats ParseCache::stats() {
+		lock_guard<mutex> g(lock);
+		return counts;
+	}
+
+	void ParseCache::scan() {
+		auto files = listFiles(dir);
+		sort(files.begin(), files.end(), [](const File& a, const File& b) {
+			return a.time < b.time;
+		});
+		lock_guard<mutex> g(lock);
+		for (auto& f : files) {
+			order.push_back({ f.name, f.size });
+			index[f.name] = prev(order.end());
+			counts.bytes += f.size;
+			counts.files++;
+		}
+	}
+
+	void ParseCache::trim(const string& keep) {
+		while (counts.bytes > limit && !order.empty() && order.front().name != keep) {
+			auto e = order.front();
+			order.pop_front();
+			index.erase(e.name);
+			remove(path(e.name).c_str());
+			counts.bytes -= e.size;
+			counts.files--;
+			counts.evictions++;
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "flat_ast.h"
+
+using namespace std;
+
+namespace Lang {
+	// Parsed trees kept in a directory between runs, one FlatAST file per
+	// source content. The key hashes the source bytes together with the
+	// parser and file format versions, so a changed source or parser
+	// never finds a stale tree. The directory is held under a byte limit
+	// by dropping the least recently used files; recency survives runs as
+	// the files' modification times. Safe to share between threads.
+	class ParseCache {
+	public:
+		struct Stats {
+			size_t   hits      = 0;
+			size_t   misses    = 0;
+			size_t   stores    = 0;
+			size_t   evictions = 0;
+			size_t   files     = 0;
+			uint64_t bytes     = 0;
+		};
+
+		// creates dir if needed and trims it to limit bytes
+		ParseCache(string dir, uint64_t limit);
+
+		ParseCache(const ParseCache&) = delete;
+		ParseCache& operator=(const ParseCache&) = delete;
+
+		// 128 bits of hash over a source: name picks the file, and check,
+		// kept inside it, must match too, so two sources that share a
+		// name are told apart instead of one getting the other's tree
+		struct Key {
+			uint64_t name  = 0;
+			uint64_t check = 0;
+		};
+		static Key key(const char* data, size_t size);
+
+		// true and flat loaded when key is cached
+		bool load(const Key& key, FlatAST& flat);
+		void store(const Key& key, const FlatAST& flat);
+
+		Stats stats();
+
+	private:
+		struct Entry {
+			string   name;
+			uint64_t size;
+		};
+
+		string                                         dir;
+		uint64_t                                       limit;
+		mutex                                          lock;
+		// least recently used first
+		list<Entry>                                    order;
+		unordered_map<string, list<Entry>::iterator>   index;
+		Stats                                          counts;
+		atomic<unsigned>                               temps{ 0 };
+
+		string path(const string& name) const {
+			return dir + "/" + name;
+		}
+
+		void scan();
+		// drops entries from the front until the total fits, keeping keep
+		void trim(const string& keep);
+	};
+}
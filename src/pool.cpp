@@ -0,0 +1,83 @@
+#include "pool.h"
+
+namespace Lang {
+	namespace {
+		// the pool and queue the current thread works for, if any
+		thread_local WorkPool* currentPool  = nullptr;
+		thread_local unsigned  currentQueue = 0;
+	}
+
+	WorkPool::WorkPool(unsigned threads) : queued(0) {
+		if (threads == 0) threads = thread::hardware_concurrency();
+		if (threads == 0) threads = 1;
+		for (unsigned i = 0; i < threads; i++) queues.emplace_back(new Queue());
+		for (unsigned i = 0; i < threads; i++) workers.emplace_back(&WorkPool::run, this, i);
+	}
+
+	WorkPool::~WorkPool() {
+		{
+			lock_guard<mutex> g(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& t : workers) t.join();
+	}
+
+	void WorkPool::submit(function<void()> task) {
+		// counted before the push so a fast worker cannot finish the task
+		// and drop pending to zero under a concurrent wait()
+		unsigned i = currentQueue;
+		{
+			lock_guard<mutex> g(lock);
+			if (currentPool != this) i = next++ % size();
+			pending++;
+			queued++;
+		}
+		{
+			lock_guard<mutex> g(queues[i]->lock);
+			queues[i]->tasks.push_back(move(task));
+		}
+		wake.notify_one();
+	}
+
+	void WorkPool::wait() {
+		unique_lock<mutex> g(lock);
+		idle.wait(g, [this] { return pending == 0; });
+	}
+
+	void WorkPool::run(unsigned self) {
+		currentPool = this;
+		currentQueue = self;
+		for (;;) {
+			function<void()> task;
+			if (take(self, task)) {
+				task();
+				lock_guard<mutex> g(lock);
+				if (--pending == 0) idle.notify_all();
+				continue;
+			}
+			unique_lock<mutex> g(lock);
+			wake.wait(g, [this] { return stopping || queued > 0; });
+			if (stopping && queued == 0) return;
+		}
+	}
+
+	bool WorkPool::take(unsigned self, function<void()>& task) {
+		auto n = size();
+		for (unsigned k = 0; k < n; k++) {
+			auto& q = *queues[(self + k) % n];
+			lock_guard<mutex> g(q.lock);
+			if (q.tasks.empty()) continue;
+			if (k == 0) {
+				task = move(q.tasks.back());
+				q.tasks.pop_back();
+			} else {
+				task = move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			queued--;
+			return true;
+		}
+		return false;
+	}
+}
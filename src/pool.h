@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Lang {
+	// Fixed set of worker threads, each with its own task deque. A worker
+	// takes the newest task from its own deque and, when that is empty,
+	// steals the oldest task from the others.
+	class WorkPool {
+	public:
+		// threads == 0 uses one worker per hardware thread
+		explicit WorkPool(unsigned threads = 0);
+		~WorkPool();
+
+		WorkPool(const WorkPool&) = delete;
+		WorkPool& operator=(const WorkPool&) = delete;
+
+		unsigned size() const { return (unsigned)queues.size(); }
+
+		// Tasks submitted from a worker go to that worker's own deque,
+		// others are spread over the deques in turn.
+		void submit(function<void()> task);
+
+		// Blocks until every submitted task has finished. Not for use from
+		// inside a task.
+		void wait();
+
+	private:
+		struct Queue {
+			mutex                    lock;
+			deque<function<void()>>  tasks;
+		};
+
+		vector<unique_ptr<Queue>> queues;
+		vector<thread>            workers;
+
+		mutex                     lock;
+		condition_variable        wake;
+		condition_variable        idle;
+		atomic<size_t>            queued;
+		size_t                    pending  = 0;
+		unsigned                  next     = 0;
+		bool                      stopping = false;
+
+		void run(unsigned self);
+		bool take(unsigned self, function<void()>& task);
+	};
+}
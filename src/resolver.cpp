@@ -0,0 +1,232 @@
+#include "resolver.h"
+#include <algorithm>
+
+namespace Lang {
+	Resolver::Resolver() {
+		self = Interner::global().intern("self");
+	}
+
+	size_t Resolver::resolve(AST::Node* root) {
+		Resolver r;
+		r.walk(root);
+		r.run();
+		return r.unresolved;
+	}
+
+	// the part of an expression that is not one, a function type say,
+	// is left to steps of its own
+	void Resolver::expression(AST::Node* n) {
+		inExpression = true;
+		operands.push_back(n);
+		while (!operands.empty()) {
+			auto o = operands.back();
+			operands.pop_back();
+			auto asked = operands.size();
+			visit(o);
+			reverse(operands.begin() + asked, operands.end());
+		}
+		inExpression = false;
+	}
+
+	void Resolver::run() {
+		while (!todo.empty()) {
+			auto s = todo.back();
+			todo.pop_back();
+			// what the step asks for is pushed in order and taken from the back
+			auto asked = todo.size();
+			switch (s.op) {
+			case Step::sVisit:
+				if (declaresNothing(s.node)) expression(s.node);
+				else visit(s.node);
+				break;
+			case Step::sDeclare: declare(cast<AST::IdentifierNode>(s.node), s.decl); break;
+			case Step::sSelf:    bind(self, s.node); break;
+			case Step::sEnter:   enter(cast<AST::ScopeNode>(s.node)); break;
+			case Step::sOpen:    open(cast<AST::ScopeNode>(s.node)); break;
+			case Step::sLeave:   leave(); break;
+			}
+			reverse(todo.begin() + asked, todo.end());
+		}
+	}
+
+	void Resolver::declare(AST::IdentifierNode* name, AST::Node* decl) {
+		if (name == nullptr) return;
+		name->decl = decl;
+		if (name->symbol != 0) bind(name->symbol, decl);
+	}
+
+	void Resolver::bind(Symbol s, AST::Node* decl) {
+		if (s >= bound.size()) bound.resize(s + 1, nullptr);
+		undo.push_back({ s, bound[s] });
+		bound[s] = decl;
+	}
+
+	void Resolver::declareGenerics(AST::DefineNameNode* name, AST::Node* decl) {
+		if (name == nullptr) return;
+		if (name->name != nullptr) name->name->decl = decl;
+		for (auto g : name->genericNames) declare(g, g);
+	}
+
+	void Resolver::enter(AST::ScopeNode* s) {
+		s->outerScope = scope;
+		scope = s;
+	}
+
+	void Resolver::open(AST::ScopeNode* s) {
+		marks.push_back({ undo.size(), scope });
+		if (s != nullptr) enter(s);
+	}
+
+	void Resolver::leave() {
+		auto mark = marks.back().first;
+		while (undo.size() > mark) {
+			bound[undo.back().first] = undo.back().second;
+			undo.pop_back();
+		}
+		scope = marks.back().second;
+		marks.pop_back();
+	}
+
+	void Resolver::visitNode(AST::Node* n) {
+		visitChildren(n);
+	}
+
+	void Resolver::visitChildren(AST::Node* n) {
+		forEachChild(n, [this](AST::Node* c) { walk(c); });
+	}
+
+	void Resolver::visitIdentifier(AST::IdentifierNode* n) {
+		auto s = n->symbol;
+		n->decl = s != 0 && s < bound.size() ? bound[s] : nullptr;
+		if (n->decl == nullptr) unresolved++;
+	}
+
+	// the right side of `.` names a member of whatever the left side is
+	void Resolver::visitBinaryOperator(AST::BinaryOperatorNode* n) {
+		if (!n->token->isOperator(Token::tDot)) {
+			visitChildren(n);
+			return;
+		}
+		walk(n->left);
+		if (!isa<AST::IdentifierNode>(n->right)) walk(n->right);
+	}
+
+	void Resolver::visitScope(AST::ScopeNode* n) {
+		open(n);
+		visitChildren(n);
+		then(Step::sLeave);
+	}
+
+	// Named functions, structs and interfaces are in scope for the whole
+	// block, so calls and types may come before them.
+	void Resolver::visitBlock(AST::BlockNode* n) {
+		open(n);
+		for (auto c : n->nodes) {
+			if (auto f = dyn_cast<AST::DefineFuncNode>(c)) {
+				if (f->name != nullptr) declare(f->name->name, f);
+			} else if (auto d = dyn_cast<AST::DefineStructNode>(c)) {
+				if (d->name != nullptr) declare(d->name->name, d);
+			} else if (auto d = dyn_cast<AST::DefineInterfaceNode>(c)) {
+				if (d->name != nullptr) declare(d->name->name, d);
+			}
+		}
+		for (auto c : n->nodes) walk(c);
+		then(Step::sLeave);
+	}
+
+	// `else if` arms are taken by a loop, as they are parsed, each a scope
+	// inside the arm before
+	void Resolver::visitIf(AST::IfNode* n) {
+		open(n);
+		for (auto arm = n;;) {
+			if (arm != n) then(Step::sEnter, arm);
+			walk(arm->condExpr);
+			walk(arm->ifBlock);
+			auto elseIf = dyn_cast<AST::IfNode>(arm->elseBlock);
+			if (elseIf == nullptr) {
+				walk(arm->elseBlock);
+				break;
+			}
+			arm = elseIf;
+		}
+		then(Step::sLeave);
+	}
+
+	// the collection is evaluated outside the loop variable's scope
+	void Resolver::visitEach(AST::EachNode* n) {
+		walk(n->in);
+		then(Step::sOpen, n);
+		walk(n->each);
+		walk(n->block);
+		then(Step::sLeave);
+	}
+
+	void Resolver::visitDefineFunc(AST::DefineFuncNode* n) {
+		open(n);
+		declareGenerics(n->name, n);
+		for (auto a : n->args) {
+			if (a == nullptr) continue;
+			walk(a->type);
+			walk(a->defaultValue);
+			then(Step::sDeclare, a->name, a);
+		}
+		walk(n->returnType);
+		walk(n->block);
+		then(Step::sLeave);
+	}
+
+	void Resolver::visitDeclVar(AST::DeclVarNode* n) {
+		walk(n->type);
+		then(Step::sDeclare, n->name, n);
+	}
+
+	void Resolver::visitDeclConst(AST::DeclConstNode* n) {
+		walk(n->type);
+		then(Step::sDeclare, n->name, n);
+	}
+
+	// `var x = x + 1` reads the x from before the declaration
+	void Resolver::visitAssign(AST::AssignNode* n) {
+		walk(n->value);
+		walk(n->node);
+	}
+
+	// fields of a struct; function arguments are declared by the function
+	void Resolver::visitField(AST::FieldNode* n) {
+		if (n->name != nullptr) n->name->decl = n;
+		walk(n->type);
+		walk(n->defaultValue);
+	}
+
+	void Resolver::visitDefineStruct(AST::DefineStructNode* n) {
+		open(nullptr);
+		declareGenerics(n->name, n);
+		for (auto f : n->fields) walk(f);
+		then(Step::sLeave);
+	}
+
+	// the implemented struct, its type arguments (`impl Point<int>`) and
+	// the interface are references; self names the impl in its methods
+	void Resolver::visitDefineImpl(AST::DefineImplNode* n) {
+		open(nullptr);
+		if (n->name != nullptr) {
+			walk(n->name->name);
+			for (auto g : n->name->genericNames) walk(g);
+		}
+		if (n->iface != nullptr) walk(n->iface->name);
+		then(Step::sSelf, n);
+		for (auto f : n->funcs) {
+			if (f == nullptr) continue;
+			if (f->name != nullptr && f->name->name != nullptr) f->name->name->decl = f;
+			walk(f);
+		}
+		then(Step::sLeave);
+	}
+
+	void Resolver::visitDefineInterface(AST::DefineInterfaceNode* n) {
+		open(nullptr);
+		declareGenerics(n->name, n);
+		for (auto f : n->funcs) walk(f);
+		then(Step::sLeave);
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "ast_visit.h"
+
+using namespace std;
+
+namespace Lang {
+	// Links every IdentifierNode to its declaration (IdentifierNode::decl)
+	// and every ScopeNode to the one around it (outerScope), in one walk.
+	//
+	// Symbols are dense, so the names in scope are a flat array indexed by
+	// symbol holding the innermost declaration, with an undo log of the
+	// declarations each one hid. Leaving a scope pops the log back to where
+	// the scope began. Declaring, looking up and leaving are O(1) per name,
+	// so the whole pass is linear in the tree.
+	//
+	// The walk keeps its own stack, as an operator chain is as deep as it
+	// is long. A handler deals with its node at once and asks for its
+	// children with walk(), and for what comes between them (a declaration,
+	// entering or leaving a scope) with a step; both run after the handler
+	// returns, in the order asked for, before anything the handler's caller
+	// asked for after it. Expressions declare nothing, so an expression is
+	// resolved whole in one step, from a stack of its own.
+	//
+	// Functions, structs and interfaces may be used before they appear in
+	// their block; variables and constants only after. Member names after
+	// `.`, struct fields and methods are not lexical names and stay
+	// unresolved, as do builtins such as int or println.
+	class Resolver : public NodeVisitor<Resolver> {
+	public:
+		// returns how many references found no declaration
+		static size_t resolve(AST::Node* root);
+
+		void visitNode(AST::Node* n);
+		void visitChildren(AST::Node* n);
+		void visitIdentifier(AST::IdentifierNode* n);
+		void visitBinaryOperator(AST::BinaryOperatorNode* n);
+		void visitScope(AST::ScopeNode* n);
+		void visitBlock(AST::BlockNode* n);
+		void visitIf(AST::IfNode* n);
+		void visitEach(AST::EachNode* n);
+		void visitDefineFunc(AST::DefineFuncNode* n);
+		void visitDeclVar(AST::DeclVarNode* n);
+		void visitDeclConst(AST::DeclConstNode* n);
+		void visitAssign(AST::AssignNode* n);
+		void visitField(AST::FieldNode* n);
+		void visitDefineStruct(AST::DefineStructNode* n);
+		void visitDefineImpl(AST::DefineImplNode* n);
+		void visitDefineInterface(AST::DefineInterfaceNode* n);
+
+	private:
+		// bound[s] is the declaration symbol s names here; grown only as
+		// far as the symbols declared, not every symbol interned
+		vector<AST::Node*>              bound;
+		// symbols declared so far, with what each one hid
+		vector<pair<Symbol, AST::Node*>> undo;
+		AST::ScopeNode*                 scope      = nullptr;
+		size_t                          unresolved = 0;
+		Symbol                          self       = 0;
+
+		struct Step {
+			enum Op {
+				// visit node
+				sVisit,
+				// declare the IdentifierNode node as decl
+				sDeclare,
+				// bind self to node
+				sSelf,
+				// make node the current scope, in the one open()ed last
+				sEnter,
+				// open() with node as the scope, which may be nullptr
+				sOpen,
+				// undo what was declared since the last open() and go back
+				// to the scope before it
+				sLeave,
+			};
+			Op         op;
+			AST::Node* node;
+			AST::Node* decl;
+		};
+		// steps still to take, the next one last
+		vector<Step>                    todo;
+		// where the undo log stood and the scope that was current at each
+		// open() not yet left
+		vector<pair<size_t, AST::ScopeNode*>> marks;
+		// the rest of the expression being resolved
+		vector<AST::Node*>              operands;
+		bool                            inExpression = false;
+
+		Resolver();
+
+		void then(Step::Op op, AST::Node* node = nullptr, AST::Node* decl = nullptr) {
+			todo.push_back({ op, node, decl });
+		}
+
+		// operators, calls, literals and names, which declare nothing
+		static bool declaresNothing(AST::Node* n) {
+			typedef AST::Node N;
+			return n->kind <= N::nkUnaryOperator || (n->kind >= N::nkExpression && n->kind <= N::nkTupleExpr);
+		}
+
+		void walk(AST::Node* n) {
+			if (n == nullptr) return;
+			if (inExpression && declaresNothing(n)) operands.push_back(n);
+			else then(Step::sVisit, n);
+		}
+
+		void run();
+		void expression(AST::Node* n);
+		void declare(AST::IdentifierNode* name, AST::Node* decl);
+		void bind(Symbol s, AST::Node* decl);
+		void declareGenerics(AST::DefineNameNode* name, AST::Node* decl);
+		void enter(AST::ScopeNode* s);
+		void open(AST::ScopeNode* s);
+		void leave();
+	};
+}
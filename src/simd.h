@@ -0,0 +1,74 @@
+#pragma once
+
+// Instruction sets the vector code paths may use. The lexer's scanners use
+// what the build targets (LANG_SSE2, LANG_AVX2). On x86, which LANG_SSE2
+// stands for, the UTF-8 kernels are built for SSSE3 and AVX2 whatever the
+// target and picked at run time by cpuHasSsse3/cpuHasAvx2.
+// Define LANG_NO_SIMD to build the scalar fallbacks only.
+#if !defined(LANG_NO_SIMD)
+#if defined(__AVX2__)
+#define LANG_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LANG_SSE2
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Functions between LANG_TARGET_BEGIN("isa") and LANG_TARGET_END, templates
+// included, are built for that instruction set. Only call them once the
+// CPU is known to have it. MSVC takes any intrinsic anywhere.
+#define LANG_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define LANG_TARGET_BEGIN(isa) LANG_PRAGMA(clang attribute push(__attribute__((target(isa))), apply_to = function))
+#define LANG_TARGET_END        LANG_PRAGMA(clang attribute pop)
+#elif defined(__GNUC__)
+#define LANG_TARGET_BEGIN(isa) LANG_PRAGMA(GCC push_options) LANG_PRAGMA(GCC target(isa))
+#define LANG_TARGET_END        LANG_PRAGMA(GCC pop_options)
+#else
+#define LANG_TARGET_BEGIN(isa)
+#define LANG_TARGET_END
+#endif
+
+namespace Lang {
+	inline unsigned countTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+		unsigned long i;
+		_BitScanForward(&i, mask);
+		return (unsigned)i;
+#else
+		return (unsigned)__builtin_ctz(mask);
+#endif
+	}
+
+#ifdef LANG_SSE2
+	inline bool cpuHasSsse3() {
+#ifdef _MSC_VER
+		int r[4];
+		__cpuid(r, 1);
+		return (r[2] & (1 << 9)) != 0;
+#else
+		return __builtin_cpu_supports("ssse3");
+#endif
+	}
+
+	// the OS has to save the ymm registers as well
+	inline bool cpuHasAvx2() {
+#ifdef _MSC_VER
+		int r[4];
+		__cpuid(r, 0);
+		if (r[0] < 7) return false;
+		__cpuid(r, 1);
+		bool avx = (r[2] & (1 << 27)) != 0 && (r[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(r, 7, 0);
+		return avx && (r[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+}
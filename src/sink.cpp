@@ -0,0 +1,87 @@
+#include "sink.h"
+#include <algorithm>
+
+namespace Lang {
+	// Text mode unless asked, as the html was always written and read, so
+	// line endings match on Windows.
+	bool Sink::open(string path, bool binary) {
+		close();
+		file = fopen(path.c_str(), binary ? "wb" : "w");
+		if (file == nullptr) return false;
+		setvbuf(file, nullptr, _IONBF, 0);
+		reading = false;
+		reset();
+		return true;
+	}
+
+	bool Sink::compare(string path, bool binary) {
+		close();
+		file = fopen(path.c_str(), binary ? "rb" : "r");
+		if (file == nullptr) return false;
+		reading = true;
+		reset();
+		return true;
+	}
+
+	void Sink::discard() {
+		close();
+		reset();
+		counting = true;
+	}
+
+	void Sink::reset() {
+		ok = true;
+		counting = false;
+		done = 0;
+		used = 0;
+		differs = string::npos;
+		text.clear();
+	}
+
+	bool Sink::close() {
+		flush();
+		if (file == nullptr) return ok;
+		// the output must also have reached the end of the file
+		if (reading && ok && fgetc(file) != EOF) {
+			ok = false;
+			differs = done;
+		}
+		if (fclose(file) != 0 && !reading) ok = false;
+		file = nullptr;
+		return ok;
+	}
+
+	Sink& Sink::operator<<(int n) {
+		char s[16];
+		write(s, snprintf(s, sizeof(s), "%d", n));
+		return *this;
+	}
+
+	void Sink::emit(const char* p, size_t n) {
+		if (n == 0) return;
+		if (file == nullptr) {
+			if (!counting) text.append(p, n);
+			done += n;
+			return;
+		}
+		if (!ok) return;
+		if (!reading) {
+			ok = fwrite(p, 1, n, file) == n;
+			done += n;
+			return;
+		}
+		char in[4096];
+		while (n > 0) {
+			auto k = fread(in, 1, min(n, sizeof(in)), file);
+			if (k == 0 || memcmp(in, p, k) != 0) {
+				auto same = mismatch(in, in + k, p).first - in;
+				ok = false;
+				differs = done + same;
+				return;
+			}
+			p += k;
+			n -= k;
+			done += k;
+		}
+	}
+}
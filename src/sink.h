@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace Lang {
+	// Output written through a fixed buffer. With a file open the buffer
+	// goes to the file each time it fills, or is checked against the
+	// file's next bytes when comparing, so however large the output only
+	// the buffer is held. Without a file it is kept in memory for str().
+	class Sink {
+	public:
+		Sink() {}
+		~Sink() {
+			close();
+		}
+
+		Sink(const Sink&) = delete;
+		Sink& operator=(const Sink&) = delete;
+
+		// writes to path, replacing it; binary output skips the line ending
+		// translation text gets on Windows
+		bool open(string path, bool binary = false);
+		// reads path alongside, to tell whether the output is its contents
+		bool compare(string path, bool binary = false);
+		// takes the output without keeping it, to measure it with size()
+		void discard();
+		// Flushes and closes the file. False when a write failed or, when
+		// comparing, the output differs from the file.
+		bool close();
+
+		// the output, when no file is open, once closed
+		const string& str() const { return text; }
+		// how many bytes have been written
+		size_t size() const { return done + used; }
+		// when comparing, the offset of the first byte that differs from
+		// the file, or the file's size when it ends first; npos if none yet
+		size_t differsAt() const { return differs; }
+
+		void write(const char* p, size_t n) {
+			if (n > buf.size() - used) {
+				flush();
+				if (n >= buf.size()) {
+					emit(p, n);
+					return;
+				}
+			}
+			memcpy(buf.data() + used, p, n);
+			used += n;
+		}
+
+		Sink& operator<<(string_view s) {
+			write(s.data(), s.size());
+			return *this;
+		}
+
+		Sink& operator<<(const char* s) {
+			write(s, strlen(s));
+			return *this;
+		}
+
+		Sink& operator<<(int n);
+
+	private:
+		vector<char> buf = vector<char>(64 * 1024);
+		size_t       used = 0;
+		FILE*        file = nullptr;
+		bool         reading = false;
+		bool         counting = false;
+		bool         ok = true;
+		// bytes emitted so far, and where they first went wrong
+		size_t       done = 0;
+		size_t       differs = string::npos;
+		string       text;
+
+		void reset();
+		void flush() {
+			emit(buf.data(), used);
+			used = 0;
+		}
+		void emit(const char* p, size_t n);
+	};
+}
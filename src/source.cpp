@@ -0,0 +1,185 @@
+#include "source.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Lang {
+	bool Source::open(string path, bool text) {
+		close();
+		if (!map(path) && !read(path)) return false;
+		if (text) detect();
+		return true;
+	}
+
+	void Source::assign(string text) {
+		close();
+		copy = move(text);
+		buf = copy.data();
+		len = copy.size();
+		detect();
+	}
+
+	void Source::close() {
+		if (mapped) {
+#ifdef _WIN32
+			UnmapViewOfFile(buf);
+			CloseHandle((HANDLE)hMap);
+			CloseHandle((HANDLE)hFile);
+			hMap = nullptr;
+			hFile = nullptr;
+#else
+			munmap((void*)buf, len);
+#endif
+		}
+		buf = nullptr;
+		len = 0;
+		bom = 0;
+		mapped = false;
+		copy.clear();
+		enc = eUTF8;
+		eol = leNone;
+		lines.clear();
+	}
+
+	bool Source::map(string path) {
+#ifdef _WIN32
+		HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (f == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+			CloseHandle(f);
+			return false;
+		}
+		HANDLE m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m == NULL) {
+			CloseHandle(f);
+			return false;
+		}
+		void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+		if (p == NULL) {
+			CloseHandle(m);
+			CloseHandle(f);
+			return false;
+		}
+		hFile = f;
+		hMap = m;
+		buf = (const char*)p;
+		len = (size_t)size.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) return false;
+		madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+		buf = (const char*)p;
+		len = (size_t)st.st_size;
+#endif
+		mapped = true;
+		return true;
+	}
+
+	bool Source::read(string path) {
+		fstream fs(path, ios::in | ios::binary);
+		if (!fs.is_open()) return false;
+		fs.seekg(0, ios::end);
+		auto size = fs.tellg();
+		fs.seekg(0, ios::beg);
+		if (size > 0) {
+			copy.resize((size_t)size);
+			fs.read(&copy[0], size);
+			copy.resize((size_t)fs.gcount());
+		}
+		fs.close();
+		buf = copy.data();
+		len = copy.size();
+		return true;
+	}
+
+	void Source::detect() {
+		auto u = (const unsigned char*)buf;
+		if (len >= 4 && u[0] == 0xFF && u[1] == 0xFE && u[2] == 0 && u[3] == 0) {
+			enc = eUTF32LE;
+			bom = 4;
+		} else if (len >= 4 && u[0] == 0 && u[1] == 0 && u[2] == 0xFE && u[3] == 0xFF) {
+			enc = eUTF32BE;
+			bom = 4;
+		} else if (len >= 3 && u[0] == 0xEF && u[1] == 0xBB && u[2] == 0xBF) {
+			enc = eUTF8BOM;
+			bom = 3;
+		} else if (len >= 2 && u[0] == 0xFF && u[1] == 0xFE) {
+			enc = eUTF16LE;
+			bom = 2;
+		} else if (len >= 2 && u[0] == 0xFE && u[1] == 0xFF) {
+			enc = eUTF16BE;
+			bom = 2;
+		}
+		if (enc != eUTF8 && enc != eUTF8BOM) return;
+
+		// the common case has no bare \r and is settled by two memchr passes
+		auto p = data();
+		auto end = p + size();
+		size_t lf = 0, crlf = 0, cr = 0;
+		lines.push_back(0);
+		for (auto q = p; (q = (const char*)memchr(q, '\n', end - q)) != nullptr; ) {
+			if (q > p && q[-1] == '\r') crlf++;
+			else lf++;
+			q++;
+			if (q < end) lines.push_back(q - p);
+		}
+		for (auto q = p; (q = (const char*)memchr(q, '\r', end - q)) != nullptr; q++) cr++;
+		cr -= crlf;
+
+		if (cr > 0) {
+			lines.resize(1);
+			for (auto q = p; q < end; q++) {
+				if (*q == '\r' && q + 1 < end && q[1] == '\n') q++;
+				else if (*q != '\r' && *q != '\n') continue;
+				if (q + 1 < end) lines.push_back(q + 1 - p);
+			}
+		}
+
+		int kinds = (lf > 0) + (crlf > 0) + (cr > 0);
+		if (kinds > 1) eol = leMixed;
+		else if (lf > 0) eol = leLF;
+		else if (crlf > 0) eol = leCRLF;
+		else if (cr > 0) eol = leCR;
+	}
+
+	void Source::position(size_t offset, int* row, int* col) const {
+		if (lines.empty()) {
+			*row = 1;
+			*col = (int)offset + 1;
+			return;
+		}
+		auto line = (size_t)(upper_bound(lines.begin(), lines.end(), offset) - lines.begin()) - 1;
+		*row = (int)line + 1;
+		*col = (int)(offset - lines[line]) + 1;
+	}
+
+	const char* Source::name(Encoding e) {
+		switch (e) {
+		case eUTF8:    return "UTF-8";
+		case eUTF8BOM: return "UTF-8 with BOM";
+		case eUTF16LE: return "UTF-16LE";
+		case eUTF16BE: return "UTF-16BE";
+		case eUTF32LE: return "UTF-32LE";
+		case eUTF32BE: return "UTF-32BE";
+		}
+		return "unknown";
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Lang {
+	// Read-only contents of a source file, kept in one contiguous buffer.
+	// The file is memory-mapped when possible, otherwise read in one go.
+	// Encoding and line endings are detected while loading; data() starts
+	// after any byte order mark.
+	class Source {
+	public:
+		enum Encoding : unsigned char {
+			eUTF8,
+			eUTF8BOM,
+			eUTF16LE,
+			eUTF16BE,
+			eUTF32LE,
+			eUTF32BE,
+		};
+
+		enum LineEnding : unsigned char {
+			leNone,
+			leLF,
+			leCRLF,
+			leCR,
+			leMixed,
+		};
+
+		Source() {}
+		~Source() {
+			close();
+		}
+
+		Source(const Source&) = delete;
+		Source& operator=(const Source&) = delete;
+
+		// text false leaves the bytes as they are, with no BOM, encoding or
+		// line detection, for files that are not source
+		bool open(string path, bool text = true);
+		// takes text that is already in memory, such as an editor buffer
+		void assign(string text);
+		void close();
+
+		const char* data() const { return buf + bom; }
+		size_t      size() const { return len - bom; }
+
+		Encoding   encoding()   const { return enc; }
+		LineEnding lineEnding() const { return eol; }
+		static const char* name(Encoding e);
+
+		// offsets in data() at which each line begins, lineStarts()[0] == 0
+		const vector<size_t>& lineStarts() const { return lines; }
+		// the 1-based row and column of an offset in data(), as diagnostics
+		// give them
+		void position(size_t offset, int* row, int* col) const;
+
+	private:
+		const char*    buf    = nullptr;
+		size_t         len    = 0;
+		size_t         bom    = 0;
+		bool           mapped = false;
+		string         copy   = "";
+		Encoding       enc    = eUTF8;
+		LineEnding     eol    = leNone;
+		vector<size_t> lines;
+
+#ifdef _WIN32
+		void*       hFile  = nullptr;
+		void*       hMap   = nullptr;
+#endif
+		bool map(string path);
+		bool read(string path);
+		void detect();
+	};
+}
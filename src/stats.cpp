@@ -0,0 +1,133 @@
+#include "stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include "ast_visit.h"
+#include "ast_writer.h"
+
+namespace Lang {
+	namespace {
+		const char* PhaseNames[] = { "read", "utf8", "lex", "parse", "write" };
+
+		string jsonString(const string& s) {
+			string r = "\"";
+			for (unsigned char c : s) {
+				if (c == '"' || c == '\\') {
+					r += '\\';
+					r += (char)c;
+				} else if (c < 0x20) {
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", c);
+					r += buf;
+				} else {
+					r += (char)c;
+				}
+			}
+			return r + "\"";
+		}
+
+		void printJson(ostream& out, const FileStats& s) {
+			out << "{\"file\":" << jsonString(s.file) << ",\"cached\":" << (s.cached ? "true" : "false");
+			out << ",\"ms\":{";
+			for (int p = 0; p < FileStats::PhaseCount; p++) {
+				if (p > 0) out << ",";
+				out << "\"" << PhaseNames[p] << "\":" << s.seconds[p] * 1000;
+			}
+			out << "},\"bytes\":" << s.bytes << ",\"lines\":" << s.lines << ",\"tokens\":" << s.tokens
+				<< ",\"nodes\":" << s.nodes << ",\"arenaBytes\":" << s.arenaBytes
+				<< ",\"arenaBlocks\":" << s.arenaBlocks << ",\"output\":" << s.output;
+			out << ",\"kinds\":{";
+			bool first = true;
+			for (int k = 0; k < FileStats::KindCount; k++) {
+				if (s.kinds[k] == 0) continue;
+				if (!first) out << ",";
+				first = false;
+				out << "\"" << treeKindName((AST::Node::Kind)k) << "\":" << s.kinds[k];
+			}
+			out << "}}";
+		}
+
+		void printRow(ostream& out, const string& name, size_t width, const FileStats& s) {
+			out << left << setw(width) << name << right;
+			for (int p = 0; p < FileStats::PhaseCount; p++) out << setw(9) << s.seconds[p] * 1000;
+			out << setw(11) << s.bytes << setw(9) << s.lines << setw(10) << s.tokens << setw(10) << s.nodes
+				<< setw(14) << s.arenaBlocks << setw(12) << s.output;
+			if (s.cached) out << "  cached";
+			out << "\n";
+		}
+	}
+
+	void FileStats::countLines(const char* data, size_t size) {
+		lines = 0;
+		for (auto p = data, end = data + size; (p = (const char*)memchr(p, '\n', end - p)) != nullptr; p++) lines++;
+		if (size > 0 && data[size - 1] != '\n') lines++;
+	}
+
+	void FileStats::countNodes(AST::Node* root) {
+		vector<AST::Node*> stack;
+		if (root != nullptr) stack.push_back(root);
+		while (!stack.empty()) {
+			auto n = stack.back();
+			stack.pop_back();
+			nodes++;
+			kinds[n->kind]++;
+			forEachChild(n, [&](AST::Node* c) { stack.push_back(c); });
+		}
+	}
+
+	void FileStats::add(const FileStats& other) {
+		for (int p = 0; p < PhaseCount; p++) seconds[p] += other.seconds[p];
+		for (int k = 0; k < KindCount; k++) kinds[k] += other.kinds[k];
+		bytes += other.bytes;
+		lines += other.lines;
+		tokens += other.tokens;
+		nodes += other.nodes;
+		arenaBytes += other.arenaBytes;
+		arenaBlocks += other.arenaBlocks;
+		output += other.output;
+	}
+
+	void printStats(ostream& out, const vector<FileStats>& files, bool json) {
+		FileStats total;
+		for (auto& s : files) total.add(s);
+
+		if (json) {
+			out << "{\"files\":[";
+			for (size_t i = 0; i < files.size(); i++) {
+				if (i > 0) out << ",";
+				printJson(out, files[i]);
+			}
+			out << "],\"total\":";
+			printJson(out, total);
+			out << "}" << endl;
+			return;
+		}
+
+		size_t width = 5;
+		for (auto& s : files) width = max(width, s.file.size());
+		width += 2;
+
+		auto flags = out.flags();
+		auto precision = out.precision();
+		out << fixed << setprecision(2);
+		out << left << setw(width) << "file" << right;
+		for (int p = 0; p < FileStats::PhaseCount; p++) out << setw(9) << string(PhaseNames[p]) + " ms";
+		out << setw(11) << "bytes" << setw(9) << "lines" << setw(10) << "tokens" << setw(10) << "nodes"
+			<< setw(14) << "arena blocks" << setw(12) << "output" << "\n";
+		for (auto& s : files) printRow(out, s.file, width, s);
+		printRow(out, "total", width, total);
+
+		// the kinds most of the tree is made of first
+		vector<int> order;
+		for (int k = 0; k < FileStats::KindCount; k++) {
+			if (total.kinds[k] > 0) order.push_back(k);
+		}
+		stable_sort(order.begin(), order.end(), [&](int a, int b) { return total.kinds[a] > total.kinds[b]; });
+		out << "nodes by kind:";
+		for (auto k : order) out << " " << treeKindName((AST::Node::Kind)k) << " " << total.kinds[k];
+		out << "\n" << total.arenaBytes / 1024 << " KB of nodes and tokens in " << total.arenaBlocks << " arena blocks" << endl;
+		out.flags(flags);
+		out.precision(precision);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ast.h"
+
+using namespace std;
+
+namespace Lang {
+	// Where the time of one file went and what passed through it, for
+	// --stats. Only taken when asked for: processFile then reads the clock
+	// between phases, and the counts come afterwards from what the lexer,
+	// the arena and the sink keep anyway, so the phases themselves carry
+	// no counters of their own.
+	struct FileStats {
+		enum Phase {
+			// reading the file and telling its encoding
+			phRead,
+			// checking the bytes are UTF-8
+			phUtf8,
+			// tokenizing; a streaming lexer lexes during the parse instead
+			phLex,
+			// parsing, or taking the tree from the cache
+			phParse,
+			// writing or comparing the output
+			phWrite,
+			PhaseCount,
+		};
+		static constexpr int KindCount = AST::Node::nkDefineInterface + 1;
+
+		string file;
+		// wall time of each phase on a monotonic clock, in seconds
+		double seconds[PhaseCount] = {};
+		size_t bytes  = 0;
+		size_t lines  = 0;
+		size_t tokens = 0;
+		size_t nodes  = 0;
+		size_t kinds[KindCount] = {};
+		// what the nodes and tokens of the tree took from the arena, and
+		// the blocks of heap it took for them
+		size_t arenaBytes  = 0;
+		size_t arenaBlocks = 0;
+		size_t output      = 0;
+		// the tree came from the parse cache
+		bool   cached      = false;
+
+		// Starts the clock for the first phase; each mark() then gives the
+		// time since the last one to a phase.
+		void start() {
+			last = chrono::steady_clock::now();
+		}
+
+		void mark(Phase phase) {
+			auto t = chrono::steady_clock::now();
+			seconds[phase] += chrono::duration<double>(t - last).count();
+			last = t;
+		}
+
+		void countLines(const char* data, size_t size);
+		// nodes by kind under root, without recursion
+		void countNodes(AST::Node* root);
+		// adds another file's figures, for the totals
+		void add(const FileStats& other);
+
+	private:
+		chrono::steady_clock::time_point last;
+	};
+
+	// a row per file and the totals, or all of it as JSON
+	void printStats(ostream& out, const vector<FileStats>& files, bool json);
+}
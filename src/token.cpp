@@ -1,16 +1,6 @@
 #include "token.h"
-#include "lexer.h"
 
 namespace Lang {
-	Token* Token::Empty = new Token(Token::Kind::kUnknown, Token::Type::tUnknown, "#", 0, 0);
-
-	Token* Token::next(int offset) {
-		if (lex != nullptr) {
-			int i = index + offset;
-			if (i >= 0 && i < (int)lex->tokens.size()) {
-				return lex->tokens[i];
-			}
-		}
-		return Empty;
-	}
-}
\ No newline at end of file
+	static Token EmptyToken(Token::Kind::kUnknown, Token::Type::tUnknown, "#");
+	Token* const Token::Empty = &EmptyToken;
+}
@@ -1,17 +1,19 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
+#include "interner.h"
 
 using namespace std;
 
 namespace Lang {
-	class Lexer;
 	class Token {
 	public:
-		static Token* Empty;
+		// shared by every stream, never modified
+		static Token* const Empty;
 
-		enum Kind {
+		enum Kind : unsigned char {
 			kUnknown,
 			kKeyword,
 			kLiteral,
@@ -21,7 +23,7 @@ namespace Lang {
 			kBlock,
 		};
 
-		enum Type {
+		enum Type : unsigned char {
 			tUnknown,
 
 			//Literal
@@ -42,6 +44,7 @@ namespace Lang {
 			tDefineFunction,
 			tDefineStruct,
 			tDefineInterface,
+			tDefineImpl,
 
 			tDeclareVar,
 			tDeclareConst,
@@ -50,8 +53,11 @@ namespace Lang {
 			tElse,
 
 			tLoop,
+			tEach,
+			tIn,
 			tBreak,
 			tContinue,
+			tReturn,
 
 			//Operator
 			tPlus, // +
@@ -62,6 +68,11 @@ namespace Lang {
 			tUnaryMinus, // -
 
 			tAssign, // =
+			tPlusAssign, // +=
+			tMinusAssign, // -=
+			tMulitAssign, // *=
+			tDivideAssign, // /=
+			tModulusAssign, // %=
 			tEqual, // ==
 			tLessThan, // <
 			tLessEqual, // <=
@@ -116,67 +127,42 @@ namespace Lang {
 			//tTypeBinding,
 		};
 
-		Kind   kind  = Kind::kUnknown;
-		Type   type  = Type::tUnknown;
-		string value = "";
-		int    row   = 0;
-		int    col   = 0;
-		int    index = 0;
-		Lexer* lex   = nullptr;
-
-		Token(Kind k, Type t, string v, int r, int c) {
-			kind  = k;
-			type  = t;
-			value = v;
-			row   = r;
-			col   = c;
+		Kind        kind     = Kind::kUnknown;
+		Type        type     = Type::tUnknown;
+		// lexed from a source, so offset is a real position
+		bool        inStream = false;
+		unsigned    offset   = 0;
+		// interned name of an identifier, 0 for other tokens
+		Symbol      symbol   = 0;
+		string_view value    = "";
+
+		// There is no next(): a streaming lexer keeps its tokens in a window
+		// that is not contiguous, so the token after t is Lexer::at(i + 1).
+
+		Token() {}
+
+		Token(Kind k, Type t, string_view v, unsigned o = 0) {
+			kind   = k;
+			type   = t;
+			value  = v;
+			offset = o;
 		}
 
-		Token* next(int offset = 1);
+		string str() {
+			return string(value);
+		}
 
 		bool isSameTo(Token* t) {
-			return (kind == t->kind && type == t->type && value == t->value);
+			if (kind != t->kind || type != t->type) return false;
+			if (symbol != 0 && t->symbol != 0) return symbol == t->symbol;
+			return value == t->value;
 		}
 
 		//Ԫ
-		bool isBinaryOperator() {
-			if (isAssignOperator()) return true;
-			switch (type) {
-			case Type::tPlus:
-			case Type::tMinus:
-			case Type::tMulit:
-			case Type::tDivide:
-			case Type::tModulus:
-			case Type::tEqual:
-			case Type::tNotEqual:
-			case Type::tLessThan:
-			case Type::tLessEqual:
-			case Type::tGreaterThan:
-			case Type::tGreaterEqual:
-			case Type::tLogicAnd:
-			case Type::tLogicOr:
-			case Type::tBinOpAnd:
-			case Type::tBinOpOr:
-			case Type::tBinOpXor:
-			case Type::tBinOpLShift:
-			case Type::tBinOpRShift:
-			case Type::tFnCall:
-			case Type::tSubscript:
-			case Type::tDot: return true;
-			}
-			return false;
-		}
+		bool isBinaryOperator();
 
 		//һԪ
-		bool isUnaryOperator() {
-			switch (type) {
-			case Type::tLogicNot:
-			case Type::tBinOpNot:
-			case Type::tUnaryMinus:
-			case Type::tRef: return true;
-			}
-			return false;
-		}
+		bool isUnaryOperator();
 
 		bool convertToUnaryOperator() {
 			if (type == Type::tMinus) type = Type::tUnaryMinus;
@@ -184,43 +170,16 @@ namespace Lang {
 			return isUnaryOperator();
 		}
 
-		int getPriority() {
-			int priority = 1;
-			if (isAssignOperator()) return priority;
-			priority++;
-			if (type == Type::tLogicOr) return priority;
-			priority++;
-			if (type == Type::tLogicAnd) return priority;
-			priority++;
-			if (type == Type::tEqual) return priority;
-			if (type == Type::tNotEqual) return priority;
-			if (type == Type::tLessThan) return priority;
-			if (type == Type::tLessEqual) return priority;
-			if (type == Type::tGreaterThan) return priority;
-			if (type == Type::tGreaterEqual) return priority;
-			priority++;
-			if (type == Type::tMinus) return priority;
-			if (type == Type::tPlus) return priority;
-			priority++;
-			if (type == Type::tMulit) return priority;
-			if (type == Type::tDivide) return priority;
-			if (type == Type::tModulus) return priority;
-			priority++;
-			if (isUnaryOperator()) return priority;
-			priority++;
-			if (type == Type::tDot) return priority;
-			if (type == Type::tFnCall) return priority;
-			if (type == Type::tSubscript) return priority;
-			priority++;
-			//error
-			cout << "error: operator " << value << " has no priority" << endl;
-			return 0;
-		}
+		int getPriority();
 
 		bool isIdentifier() {
 			return kind == Kind::kIdentifier;
 		}
 
+		bool isIdentifier(Symbol s) {
+			return isIdentifier() && symbol == s;
+		}
+
 		bool isLiteral() {
 			return kind == Kind::kLiteral;
 		}
@@ -237,9 +196,7 @@ namespace Lang {
 			return isOperator() && type == t;
 		}
 
-		bool isOperator(string t) {
-			return isOperator() && value == t;
-		}
+		bool isOperator(string_view t);
 
 		bool isKeyword() {
 			return kind == Kind::kKeyword;
@@ -249,24 +206,204 @@ namespace Lang {
 			return isKeyword() && type == t;
 		}
 
-		bool isKeyword(string t) {
-			return isKeyword() && value == t;
-		}
+		bool isKeyword(string_view t);
 
 		bool isComment() {
 			return kind == Kind::kComment;
 		}
 
-		bool isAssignOperator() {
-			if (isOperator()) {
-				if (value == "=") return true;
-				if (value == "+=") return true;
-				if (value == "-=") return true;
-				if (value == "*=") return true;
-				if (value == "/=") return true;
-				if (value == "%=") return true;
+		bool isAssignOperator();
+	};
+
+	// Every keyword and operator the language knows, with the kind and type
+	// a token spelled that way gets.
+	struct Lexeme {
+		string_view text;
+		Token::Kind kind;
+		Token::Type type;
+	};
+
+	constexpr Lexeme Lexemes[] = {
+		{ "fn",        Token::kKeyword,  Token::tDefineFunction },
+		{ "struct",    Token::kKeyword,  Token::tDefineStruct },
+		{ "interface", Token::kKeyword,  Token::tDefineInterface },
+		{ "impl",      Token::kKeyword,  Token::tDefineImpl },
+		{ "var",       Token::kKeyword,  Token::tDeclareVar },
+		{ "const",     Token::kKeyword,  Token::tDeclareConst },
+		{ "if",        Token::kKeyword,  Token::tIf },
+		{ "else",      Token::kKeyword,  Token::tElse },
+		{ "loop",      Token::kKeyword,  Token::tLoop },
+		{ "each",      Token::kKeyword,  Token::tEach },
+		{ "in",        Token::kKeyword,  Token::tIn },
+		{ "break",     Token::kKeyword,  Token::tBreak },
+		{ "continue",  Token::kKeyword,  Token::tContinue },
+		{ "return",    Token::kKeyword,  Token::tReturn },
+		{ "true",      Token::kLiteral,  Token::tBoolean },
+		{ "false",     Token::kLiteral,  Token::tBoolean },
+
+		{ "+",         Token::kOperator, Token::tPlus },
+		{ "-",         Token::kOperator, Token::tMinus },
+		{ "*",         Token::kOperator, Token::tMulit },
+		{ "/",         Token::kOperator, Token::tDivide },
+		{ "%",         Token::kOperator, Token::tModulus },
+		{ "==",        Token::kOperator, Token::tEqual },
+		{ "<",         Token::kOperator, Token::tLessThan },
+		{ "<=",        Token::kOperator, Token::tLessEqual },
+		{ "!=",        Token::kOperator, Token::tNotEqual },
+		{ ">",         Token::kOperator, Token::tGreaterThan },
+		{ ">=",        Token::kOperator, Token::tGreaterEqual },
+		{ "&&",        Token::kOperator, Token::tLogicAnd },
+		{ "||",        Token::kOperator, Token::tLogicOr },
+		{ "!",         Token::kOperator, Token::tLogicNot },
+		{ "&",         Token::kOperator, Token::tBinOpAnd },
+		{ "|",         Token::kOperator, Token::tBinOpOr },
+		{ "^",         Token::kOperator, Token::tBinOpXor },
+		{ "~",         Token::kOperator, Token::tBinOpNot },
+		{ "<<",        Token::kOperator, Token::tBinOpLShift },
+		{ ">>",        Token::kOperator, Token::tBinOpRShift },
+		{ ".",         Token::kOperator, Token::tDot },
+		{ ",",         Token::kOperator, Token::tComma },
+		{ ";",         Token::kOperator, Token::tSemicolon },
+		{ ":",         Token::kOperator, Token::tColon },
+		{ "->",        Token::kOperator, Token::tRArrow },
+		{ "(",         Token::kOperator, Token::tLParen },
+		{ ")",         Token::kOperator, Token::tRParen },
+		{ "[",         Token::kOperator, Token::tLBracket },
+		{ "]",         Token::kOperator, Token::tRBracket },
+		{ "{",         Token::kOperator, Token::tLBrace },
+		{ "}",         Token::kOperator, Token::tRBrace },
+		{ "=",         Token::kOperator, Token::tAssign },
+		{ "+=",        Token::kOperator, Token::tPlusAssign },
+		{ "-=",        Token::kOperator, Token::tMinusAssign },
+		{ "*=",        Token::kOperator, Token::tMulitAssign },
+		{ "/=",        Token::kOperator, Token::tDivideAssign },
+		{ "%=",        Token::kOperator, Token::tModulusAssign },
+	};
+
+	// Perfect hash over Lexemes: the first two bytes, last byte and length
+	// are packed into a word and multiplied by a seed found at compile time
+	// that sends every lexeme to its own slot, so a lookup is one probe and
+	// one short compare.
+	class LexemeTable {
+	public:
+		static constexpr unsigned Bits  = 8;
+		static constexpr unsigned Size  = 1 << Bits;
+		static constexpr unsigned Count = sizeof(Lexemes) / sizeof(Lexemes[0]);
+
+		unsigned      seed        = 0;
+		unsigned char slots[Size] = {}; // index into Lexemes + 1, 0 if empty
+
+		static constexpr unsigned hash(string_view s, unsigned seed) {
+			if (s.empty()) return 0;
+			unsigned key = (unsigned char)s[0]
+				| (unsigned char)s[s.size() > 1 ? 1 : 0] << 8
+				| (unsigned char)s[s.size() - 1] << 16
+				| (unsigned)s.size() << 24;
+			return (key * seed) >> (32 - Bits);
+		}
+
+		constexpr const Lexeme* find(string_view s) const {
+			auto i = slots[hash(s, seed)];
+			if (i != 0 && Lexemes[i - 1].text == s) return &Lexemes[i - 1];
+			return nullptr;
+		}
+
+		static constexpr LexemeTable build() {
+			for (unsigned seed = 0x9E3779B1; seed != 0x9E3779B1 + 2 * 100000; seed += 2) {
+				LexemeTable t;
+				t.seed = seed;
+				bool ok = true;
+				for (unsigned i = 0; i < Count && ok; i++) {
+					auto h = hash(Lexemes[i].text, seed);
+					if (t.slots[h] != 0) ok = false;
+					t.slots[h] = (unsigned char)(i + 1);
+				}
+				if (ok) return t;
 			}
-			return false;
+			return LexemeTable();
+		}
+	};
+
+	constexpr LexemeTable Lexicon = LexemeTable::build();
+	static_assert(Lexicon.seed != 0, "no perfect hash seed for Lexemes");
+
+	constexpr const Lexeme* findLexeme(string_view s) {
+		return Lexicon.find(s);
+	}
+
+	inline bool Token::isOperator(string_view t) {
+		auto l = findLexeme(t);
+		if (l == nullptr || l->type == Type::tUnknown) return isOperator() && value == t;
+		return isOperator() && type == l->type;
+	}
+
+	inline bool Token::isKeyword(string_view t) {
+		auto l = findLexeme(t);
+		return isKeyword() && l != nullptr && type == l->type;
+	}
+
+	// How each operator type parses. priority runs from 0, the loosest
+	// (& | ^ << >>, which are not ranked yet), to 8 for . call and
+	// subscript; types that are not operators have arity 0.
+	struct OperatorInfo {
+		enum Assoc : unsigned char {
+			aLeft,
+			aRight,
+			aPrefix,
+		};
+
+		unsigned char priority = 0;
+		Assoc         assoc    = aLeft;
+		unsigned char arity    = 0;
+		bool          assign   = false;
+	};
+
+	constexpr int UnaryPriority = 7;
+
+	struct OperatorTable {
+		OperatorInfo ops[256] = {};
+
+		constexpr const OperatorInfo& operator[](Token::Type t) const {
+			return ops[(unsigned char)t];
 		}
 	};
+
+	constexpr OperatorTable makeOperatorTable() {
+		OperatorTable t;
+		auto binary = [&t](Token::Type type, int priority) {
+			t.ops[type] = { (unsigned char)priority, OperatorInfo::aLeft, 2, false };
+		};
+		for (auto type : { Token::tAssign, Token::tPlusAssign, Token::tMinusAssign, Token::tMulitAssign, Token::tDivideAssign, Token::tModulusAssign }) {
+			t.ops[type] = { 1, OperatorInfo::aRight, 2, true };
+		}
+		binary(Token::tLogicOr, 2);
+		binary(Token::tLogicAnd, 3);
+		for (auto type : { Token::tEqual, Token::tNotEqual, Token::tLessThan, Token::tLessEqual, Token::tGreaterThan, Token::tGreaterEqual }) binary(type, 4);
+		for (auto type : { Token::tPlus, Token::tMinus }) binary(type, 5);
+		for (auto type : { Token::tMulit, Token::tDivide, Token::tModulus }) binary(type, 6);
+		for (auto type : { Token::tLogicNot, Token::tBinOpNot, Token::tUnaryMinus, Token::tRef }) {
+			t.ops[type] = { UnaryPriority, OperatorInfo::aPrefix, 1, false };
+		}
+		for (auto type : { Token::tDot, Token::tFnCall, Token::tSubscript }) binary(type, 8);
+		for (auto type : { Token::tBinOpAnd, Token::tBinOpOr, Token::tBinOpXor, Token::tBinOpLShift, Token::tBinOpRShift }) binary(type, 0);
+		return t;
+	}
+
+	constexpr OperatorTable Operators = makeOperatorTable();
+
+	inline bool Token::isBinaryOperator() {
+		return Operators[type].arity == 2;
+	}
+
+	inline bool Token::isUnaryOperator() {
+		return Operators[type].arity == 1;
+	}
+
+	inline int Token::getPriority() {
+		return Operators[type].priority;
+	}
+
+	inline bool Token::isAssignOperator() {
+		return Operators[type].assign;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "utf8.h"
+#include "simd.h"
+#include <cstring>
+
+#ifdef LANG_SSE2
+// utf8_avx2.cpp and utf8_ssse3.cpp
+bool utf8CheckAvx2(const unsigned char* s, size_t len, size_t& block);
+bool utf8CheckSsse3(const unsigned char* s, size_t len, size_t& block);
+#endif
+
+namespace {
+	// Validates the sequences that start in [i, stop). Returns false with i at
+	// the invalid sequence, or true with i just past the last sequence checked
+	// (which may be a few bytes beyond stop).
+	bool scalarRange(const unsigned char* s, size_t& i, size_t stop, size_t len) {
+		while (i < stop) {
+			unsigned c = s[i];
+			if (c < 0x80) {
+				i++;
+				continue;
+			}
+			size_t n;
+			unsigned lo = 0x80, hi = 0xBF;
+			if (c >= 0xC2 && c <= 0xDF) n = 2;
+			else if (c == 0xE0) { n = 3; lo = 0xA0; }
+			else if (c == 0xED) { n = 3; hi = 0x9F; }
+			else if (c >= 0xE1 && c <= 0xEF) n = 3;
+			else if (c == 0xF0) { n = 4; lo = 0x90; }
+			else if (c >= 0xF1 && c <= 0xF3) n = 4;
+			else if (c == 0xF4) { n = 4; hi = 0x8F; }
+			else return false;
+
+			if (i + n > len) return false;
+			if (s[i + 1] < lo || s[i + 1] > hi) return false;
+			for (size_t k = 2; k < n; k++) {
+				if ((s[i + k] & 0xC0) != 0x80) return false;
+			}
+			i += n;
+		}
+		return true;
+	}
+
+	size_t scalarValidate(const unsigned char* s, size_t i, size_t len) {
+		if (scalarRange(s, i, len, len)) return len;
+		return i;
+	}
+
+#ifdef LANG_SSE2
+	// the vector check only knows the block; find the exact offset by
+	// rescanning from the last character boundary before it
+	size_t simdValidate(bool (*check)(const unsigned char*, size_t, size_t&), const unsigned char* s, size_t len) {
+		size_t i;
+		if (check(s, len, i)) return len;
+		size_t j = i >= 3 ? i - 3 : 0;
+		while (j < i && (s[j] & 0xC0) == 0x80) j++;
+		return scalarValidate(s, j, len);
+	}
+
+	// Without byte shuffles only pure ASCII blocks can be skipped quickly.
+	size_t asciiSkipValidate(const unsigned char* s, size_t len) {
+		size_t i = 0;
+		while (i + 64 <= len) {
+			auto a = _mm_or_si128(_mm_loadu_si128((const __m128i*)(s + i)), _mm_loadu_si128((const __m128i*)(s + i + 16)));
+			auto b = _mm_or_si128(_mm_loadu_si128((const __m128i*)(s + i + 32)), _mm_loadu_si128((const __m128i*)(s + i + 48)));
+			if (_mm_movemask_epi8(_mm_or_si128(a, b)) == 0) {
+				i += 64;
+				continue;
+			}
+			if (!scalarRange(s, i, i + 64, len)) return i;
+		}
+		return scalarValidate(s, i, len);
+	}
+#endif
+}
+
+bool isUTF8(const char* data, size_t len, size_t* errorOffset) {
+	auto s = (const unsigned char*)data;
+#ifdef LANG_SSE2
+	static const bool avx2 = Lang::cpuHasAvx2();
+	static const bool ssse3 = Lang::cpuHasSsse3();
+	size_t bad = avx2 ? simdValidate(utf8CheckAvx2, s, len)
+		: ssse3 ? simdValidate(utf8CheckSsse3, s, len)
+		: asciiSkipValidate(s, len);
+#else
+	size_t bad = scalarValidate(s, 0, len);
+#endif
+	if (bad == len) return true;
+	if (errorOffset != nullptr) *errorOffset = bad;
+	return false;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Checks that data[0, len) is well-formed UTF-8 (RFC 3629: no overlong
+// forms, surrogates or code points above U+10FFFF). On failure the offset of
+// the first byte of the first invalid sequence is stored in *errorOffset.
+bool isUTF8(const char* data, size_t len, size_t* errorOffset = nullptr);
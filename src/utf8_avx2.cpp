@@ -0,0 +1,42 @@
+// The AVX2 kernel of isUTF8, built for AVX2 whatever the rest of the
+// program targets. isUTF8 only calls it where cpuHasAvx2().
+#include "simd.h"
+
+#ifdef LANG_SSE2
+#include <cstddef>
+#include <cstring>
+
+LANG_TARGET_BEGIN("avx2")
+#include "utf8_simd.h"
+
+namespace {
+	struct Avx2 {
+		typedef __m256i V;
+		static const size_t Width = 32;
+
+		static V load(const unsigned char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+		static V table(const unsigned char* t) { return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t)); }
+		static V set1(unsigned char c) { return _mm256_set1_epi8((char)c); }
+		static V zero() { return _mm256_setzero_si256(); }
+		static V bitAnd(V a, V b) { return _mm256_and_si256(a, b); }
+		static V bitOr(V a, V b) { return _mm256_or_si256(a, b); }
+		static V bitXor(V a, V b) { return _mm256_xor_si256(a, b); }
+		static V lookup(V table, V index) { return _mm256_shuffle_epi8(table, index); }
+		static V subs(V a, V b) { return _mm256_subs_epu8(a, b); }
+		static V highNibble(V v) { return _mm256_and_si256(_mm256_srli_epi16(v, 4), set1(0x0F)); }
+		static bool isZero(V v) { return _mm256_testz_si256(v, v) != 0; }
+		static bool isASCII(V v) { return _mm256_movemask_epi8(v) == 0; }
+
+		// The vector formed by the last N bytes of prev followed by input.
+		template<int N>
+		static V prev(V input, V prev) {
+			return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+		}
+	};
+}
+
+bool utf8CheckAvx2(const unsigned char* s, size_t len, size_t& block) {
+	return simdCheck<Avx2>(s, len, block);
+}
+LANG_TARGET_END
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+
+// The vector UTF-8 check isUTF8 runs where the CPU allows, shared by the
+// kernels in utf8_avx2.cpp and utf8_ssse3.cpp. Each includes it inside
+// its LANG_TARGET_BEGIN region, with the standard headers before it.
+
+#include <cstddef>
+#include <cstring>
+
+namespace {
+	// The lookup algorithm from simdjson (Keiser & Lemire, "Validating UTF-8
+	// In Less Than One Instruction Per Byte"). Every byte is classified by the
+	// high nibble of the previous byte, the low nibble of the previous byte and
+	// the high nibble of the byte itself; an error remains only when all three
+	// lookups agree. Lengths of 3 and 4 byte sequences are checked separately.
+	const unsigned char TooShort  = 1 << 0; // 11______ 0_______, 11______ 11______
+	const unsigned char TooLong   = 1 << 1; // 0_______ 10______
+	const unsigned char Overlong3 = 1 << 2; // 11100000 100_____
+	const unsigned char TooLarge  = 1 << 3; // 11110100 1001____ and above
+	const unsigned char Surrogate = 1 << 4; // 11101101 101_____
+	const unsigned char Overlong2 = 1 << 5; // 1100000_ 10______
+	const unsigned char Large1000 = 1 << 6; // 11110101 1000____ and above
+	const unsigned char Overlong4 = 1 << 6; // 11110000 1000____
+	const unsigned char TwoConts  = 1 << 7; // 10______ 10______
+	const unsigned char Carry     = TooShort | TooLong | TwoConts;
+
+	alignas(16) const unsigned char Byte1High[16] = {
+		TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+		TwoConts, TwoConts, TwoConts, TwoConts,
+		TooShort | Overlong2,
+		TooShort,
+		TooShort | Overlong3 | Surrogate,
+		TooShort | TooLarge | Large1000 | Overlong4,
+	};
+
+	alignas(16) const unsigned char Byte1Low[16] = {
+		Carry | Overlong3 | Overlong2 | Overlong4,
+		Carry | Overlong2,
+		Carry,
+		Carry,
+		Carry | TooLarge,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000 | Surrogate,
+		Carry | TooLarge | Large1000,
+		Carry | TooLarge | Large1000,
+	};
+
+	alignas(16) const unsigned char Byte2High[16] = {
+		TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+		TooLong | Overlong2 | TwoConts | Overlong3 | Large1000 | Overlong4,
+		TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+		TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+		TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+		TooShort, TooShort, TooShort, TooShort,
+	};
+
+	// A block ending in one of these bytes leaves a sequence open.
+	alignas(32) const unsigned char IncompleteMax[32] = {
+		255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+		255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+		0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+	};
+
+	template<class S>
+	class Checker {
+	public:
+		typedef typename S::V V;
+		static const size_t Block = 64;
+		static const size_t Lanes = Block / S::Width;
+
+		V error;
+		V prevInput;
+		V prevIncomplete;
+
+		// written out, as an implicit one is not built for the target
+		Checker() : error(S::zero()), prevInput(S::zero()), prevIncomplete(S::zero()) {}
+
+		void checkBlock(const unsigned char* p) {
+			V in[Lanes];
+			V any = S::zero();
+			for (size_t k = 0; k < Lanes; k++) {
+				in[k] = S::load(p + k * S::Width);
+				any = S::bitOr(any, in[k]);
+			}
+			if (S::isASCII(any)) {
+				error = S::bitOr(error, prevIncomplete);
+			} else {
+				checkBytes(in[0], prevInput);
+				for (size_t k = 1; k < Lanes; k++) checkBytes(in[k], in[k - 1]);
+				prevIncomplete = S::subs(in[Lanes - 1], S::load(IncompleteMax + 32 - S::Width));
+			}
+			prevInput = in[Lanes - 1];
+		}
+
+		bool failed() {
+			return !S::isZero(error);
+		}
+
+	private:
+		void checkBytes(V input, V prev) {
+			V prev1 = S::template prev<1>(input, prev);
+			V b1h = S::lookup(S::table(Byte1High), S::highNibble(prev1));
+			V b1l = S::lookup(S::table(Byte1Low), S::bitAnd(prev1, S::set1(0x0F)));
+			V b2h = S::lookup(S::table(Byte2High), S::highNibble(input));
+			V special = S::bitAnd(S::bitAnd(b1h, b1l), b2h);
+
+			// bytes 2 and 3 places after a 3 or 4 byte lead must continue it
+			V third  = S::subs(S::template prev<2>(input, prev), S::set1(0xE0 - 0x80));
+			V fourth = S::subs(S::template prev<3>(input, prev), S::set1(0xF0 - 0x80));
+			V must   = S::bitAnd(S::bitOr(third, fourth), S::set1(0x80));
+			error = S::bitOr(error, S::bitXor(must, special));
+		}
+	};
+
+	// True when s[0, len) is valid. Otherwise block is the offset of the
+	// block the error was seen in, which may be len for a sequence left
+	// open at the end.
+	template<class S>
+	bool simdCheck(const unsigned char* s, size_t len, size_t& block) {
+		Checker<S> c;
+		const size_t Block = Checker<S>::Block;
+		size_t i = 0;
+		for (; i + Block <= len; i += Block) {
+			c.checkBlock(s + i);
+			if (c.failed()) break;
+		}
+		if (!c.failed()) {
+			// the zero padding also flags a sequence left open at the end
+			alignas(32) unsigned char tail[Block] = {};
+			memcpy(tail, s + i, len - i);
+			c.checkBlock(tail);
+			if (!c.failed()) return true;
+		}
+		block = i;
+		return false;
+	}
+}
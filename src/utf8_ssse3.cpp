@@ -0,0 +1,41 @@
+// The SSSE3 kernel of isUTF8, built for SSSE3 whatever the rest of the
+// program targets. isUTF8 only calls it where cpuHasSsse3().
+#include "simd.h"
+
+#ifdef LANG_SSE2
+#include <cstddef>
+#include <cstring>
+
+LANG_TARGET_BEGIN("ssse3")
+#include "utf8_simd.h"
+
+namespace {
+	struct Ssse3 {
+		typedef __m128i V;
+		static const size_t Width = 16;
+
+		static V load(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+		static V table(const unsigned char* t) { return _mm_load_si128((const __m128i*)t); }
+		static V set1(unsigned char c) { return _mm_set1_epi8((char)c); }
+		static V zero() { return _mm_setzero_si128(); }
+		static V bitAnd(V a, V b) { return _mm_and_si128(a, b); }
+		static V bitOr(V a, V b) { return _mm_or_si128(a, b); }
+		static V bitXor(V a, V b) { return _mm_xor_si128(a, b); }
+		static V lookup(V table, V index) { return _mm_shuffle_epi8(table, index); }
+		static V subs(V a, V b) { return _mm_subs_epu8(a, b); }
+		static V highNibble(V v) { return _mm_and_si128(_mm_srli_epi16(v, 4), set1(0x0F)); }
+		static bool isZero(V v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF; }
+		static bool isASCII(V v) { return _mm_movemask_epi8(v) == 0; }
+
+		template<int N>
+		static V prev(V input, V prev) {
+			return _mm_alignr_epi8(input, prev, 16 - N);
+		}
+	};
+}
+
+bool utf8CheckSsse3(const unsigned char* s, size_t len, size_t& block) {
+	return simdCheck<Ssse3>(s, len, block);
+}
+LANG_TARGET_END
+#endif
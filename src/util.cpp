@@ -20,56 +20,13 @@ string getFileContent(string file) {
 	fstream fs(file, ios::in);
 	if (fs.is_open()) {
 		stringstream ss;
-		char ch;
-		while (fs.peek() != EOF) {
-			fs.read(&ch, 1);
-			ss << ch;
-		}
+		ss << fs.rdbuf();
 		fs.close();
 		return ss.str();
 	}
 	return "";
 }
 
-bool isUTF8(string content) {
-	auto printChar = [](char c) {
-		for (int i = 0; i < 8; i++) {
-			cout << ((c&(0b10000000 >> i)) == (0b10000000 >> i)) ? 1 : 0;
-		}
-		cout << endl;
-	};
-	auto isASCII = [](char c)->bool {
-		return (c & 0b01111111) == c;
-	};
-	auto getUTF8Len = [](char c)->int {
-		int n = 0;
-		int i = 0b10000000;
-		while (n < 4 && (c&i) == i) {
-			n++;
-			i >>= 1;
-		}
-		if ((c&(~(i >> 1))) == c) return n;
-		return -1;
-	};
-	auto isUTF8Body = [](char c)->bool {
-		return ((c & 0b10000000) == 0b10000000) && ((c & (char)0b10111111) == c);
-	};
-
-	int cnt = 0;
-	for (auto c : content) {
-		if (cnt == 0) {
-			if (isASCII(c)) continue;
-			cnt = getUTF8Len(c);
-			if (cnt < 2) return false;
-			cnt -= 1;
-		} else {
-			if (!isUTF8Body(c)) return false;
-			cnt -= 1;
-		}
-	}
-	return true;
-}
-
 vector<string> getFiles(string ext) {
 	auto list = vector<string>();
 #ifdef _WIN32
@@ -115,3 +72,8 @@ void saveToFile(string f, string s) {
 bool sameToFile(string f, string s) {
 	return getFileContent(f) == s;
 }
+
+bool fileExists(string f) {
+	fstream fs(f, ios::in);
+	return fs.is_open();
+}
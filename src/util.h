@@ -8,4 +8,4 @@ string getFileContent(string file);
 vector<string> getFiles(string ext = "xs");
 void saveToFile(string f, string s);
 bool sameToFile(string f, string s);
-bool isUTF8(string content);
\ No newline at end of file
+bool fileExists(string f);
\ No newline at end of file